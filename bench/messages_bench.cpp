@@ -0,0 +1,196 @@
+// message layer: decoding the dongle answers, encoding the SendSMS request
+// and formatting the views, on payloads recorded from an IK41 with the
+// lists grown to more sizes
+//
+// usage: asmsd-bench-messages [iterations]
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "fmt/chrono.h"
+#include "fmt/core.h"
+#include "messages_aux.hpp"
+#include "messages_fmt.hpp"
+
+namespace {
+using std::string;
+using std::vector;
+
+using namespace messages;
+
+std::atomic<size_t> allocations{};
+std::atomic<size_t> allocated{};
+
+constexpr auto SYSTEM_INFO = R"({
+"DeviceName":"IK41VE","IMEI":"356793084459875","IMEISV":"3567930844598704",
+"ICCID":"8936304419110473211","IMSI":"216304411047321","MacAddress":
+"00:1E:10:1F:00:00","HwVersion":"IK41_VE_HW01","SwVersion":"IK41_00_02.00_44",
+"SwVersionMain":"IK41_00_02.00_44","WebUiVersion":"IK41_WEBUI_2.00.44",
+"HttpApiVersion":"V3.0","BuildTime":"2019-09-05 19:03:24","DeviceMode":0,
+"Ipv4Address":"192.168.1.1","Ipv6Address":"fe80::21e:10ff:fe1f:0"})";
+
+constexpr auto SYSTEM_STATUS = R"({
+"NetworkType":8,"NetworkName":"Telekom HU","Roaming":1,"Domestic_Roaming":1,
+"SignalStrength":4,"ConnectionStatus":2,"Conprofileerror":0,"ClearCode":0,
+"mPdpRejectCount":0,"SmsState":2,"CurrentConnection":1,"TotalConnNum":1,
+"WlanState":0,"WlanUser":0})";
+
+// one recorded entry of each list, the lists repeat them with new ids
+constexpr auto SMS_CONTENT = R"({"SMSId":1043,"SMSType":0,"ReportStatus":0,
+"sms_report":1,"report_id":12,"SMSContent":
+"CRIT - db01/Filesystem /var: 97.1% used (48.5 of 50.0 GB), árvíztűrő tükör",
+"SMSTime":
+"2023-03-14 08:41:07","report_time":"2023-Mar-14 08:41:10","SMSTimezone":4})";
+
+constexpr auto SMS_CONTACT = R"({"ContactId":7,"PhoneNumber":["+36201234567"],
+"SMSId":1044,"SMSType":1,"ReportStatus":0,"sms_report":0,"report_id":0,
+"SMSContent":"OK - db01/Filesystem /var: 61.0% used","SMSTime":
+"2023-03-14 09:12:55","report_time":"2023-Mar-14 09:12:55","SMSTimezone":4,
+"UnreadCount":1,"TSMSCount":5})";
+
+aux::json grown(const char* entry, size_t n, const char* key) {
+    const auto recorded = aux::json::parse(entry);
+    auto       list     = aux::json::array();
+    for (size_t i{}; i < n; ++i) {
+        auto item       = recorded;
+        item["SMSId"]   = 1000 + i;
+        item["SMSType"] = i % 4;
+        if (item.contains("ContactId")) item["ContactId"] = i + 1;
+        list.push_back(std::move(item));
+    }
+    return {{"Page", 0}, {"TotalPageCount", (n + 9) / 10}, {key, list}};
+}
+
+string content_list(size_t n) {
+    auto list           = grown(SMS_CONTENT, n, "SMSContentList");
+    list["ContactId"]   = 7;
+    list["PhoneNumber"] = {"+36201234567"};
+    return list.dump();
+}
+
+string contact_list(size_t n) {
+    return grown(SMS_CONTACT, n, "SMSContactList").dump();
+}
+
+string response(const char* result) {
+    return fmt::format(R"({{"jsonrpc":"2.0","id":"1","result":{}}})", result);
+}
+
+template <typename Op>
+void run(const string& name, size_t iterations, Op op) {
+    using clock = std::chrono::steady_clock;
+
+    size_t check{};
+    check += op();  // warm up, the first call may allocate for good
+    allocations    = 0;
+    allocated      = 0;
+    const auto beg = clock::now();
+    for (size_t i{}; i < iterations; ++i) check += op();
+    const auto ns =
+        std::chrono::duration<double, std::nano>(clock::now() - beg);
+
+    const auto n = static_cast<double>(iterations);
+    fmt::print("  {:<32} {:>10.0f} ns/op {:>8.1f} allocs/op {:>9.0f} B/op"
+               "  ({})\n",
+               name, ns.count() / n, static_cast<double>(allocations) / n,
+               static_cast<double>(allocated) / n, check / (iterations + 1));
+}
+}  // namespace
+
+// gcc takes the replaced operators for a malloc/delete mismatch
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+    ++allocations;
+    allocated += size;
+    if (auto* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, const char* argv[]) {
+    const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 20000;
+
+    fmt::print("decode\n");
+    const string system_info{SYSTEM_INFO};
+    run("SystemInfo", iterations, [&]() {
+        SystemInfo info{};
+        aux::emplace_json(info, aux::json::parse(system_info));
+        return info.device_name().size();
+    });
+    const string system_status{SYSTEM_STATUS};
+    run("SystemStatus", iterations, [&]() {
+        SystemStatus status{};
+        aux::emplace_json(status, aux::json::parse(system_status));
+        return status.network_name().size();
+    });
+    // whole response bodies streamed into the views as the device does
+    const auto info_response = response(SYSTEM_INFO);
+    run("SystemInfo response", iterations, [&]() {
+        SystemInfo info{};
+        aux::decode(info_response, 1, {&info});
+        return info.device_name().size();
+    });
+    const auto status_response = response(SYSTEM_STATUS);
+    run("SystemStatus response", iterations, [&]() {
+        SystemStatus status{};
+        aux::decode(status_response, 1, {&status});
+        return status.network_name().size();
+    });
+    for (const size_t n : {1, 10, 100}) {
+        const auto text = content_list(n);
+        run(fmt::format("SmsContentList x{}", n), iterations / n + 1, [&]() {
+            const auto list = aux::json::parse(text).get<SmsContentList>();
+            return list.contents.size();
+        });
+    }
+    for (const size_t n : {1, 10, 100}) {
+        const auto text = contact_list(n);
+        run(fmt::format("SmsContactList x{}", n), iterations / n + 1, [&]() {
+            const auto list = aux::json::parse(text).get<SmsContactList>();
+            return list.contacts.size();
+        });
+    }
+
+    fmt::print("encode\n");
+    for (const size_t n : {1, 10}) {
+        vector<string> nums{};
+        for (size_t i{}; i < n; ++i)
+            nums.push_back(fmt::format("+3620{:07}", i));
+        run(fmt::format("SendSms x{} recipients", n), iterations, [&]() {
+            return aux::json(aux::as_param(SendSms{nums, "CRIT - db01 /var"}))
+                .dump()
+                .size();
+        });
+    }
+
+    fmt::print("format\n");
+    SystemInfo info{};
+    aux::emplace_json(info, aux::json::parse(system_info));
+    run("SystemInfo", iterations,
+        [&]() { return fmt::format("{}", info).size(); });
+    run("SystemInfo detailed", iterations,
+        [&]() { return fmt::format("{:d}", info).size(); });
+    SystemStatus status{};
+    aux::emplace_json(status, aux::json::parse(system_status));
+    run("SystemStatus detailed", iterations,
+        [&]() { return fmt::format("{:d}", status).size(); });
+    for (const size_t n : {10, 100}) {
+        const auto contents = aux::json::parse(content_list(n))
+                                  .get<SmsContentList>();
+        run(fmt::format("SmsContentList x{}", n), iterations / n + 1,
+            [&]() { return fmt::format("{}", contents).size(); });
+        const auto contacts = aux::json::parse(contact_list(n))
+                                  .get<SmsContactList>();
+        run(fmt::format("SmsContactList x{}", n), iterations / n + 1,
+            [&]() { return fmt::format("{}", contacts).size(); });
+    }
+}
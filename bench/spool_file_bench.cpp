@@ -0,0 +1,156 @@
+// spool file parsing: the getline based parser the daemon had before
+// against the single read, string_view based one
+//
+// usage: asmsd-bench-spool [iterations]
+
+#include "spool_file.hpp"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fmt/core.h"
+#include "string_trim.hpp"
+
+namespace {
+namespace fs = std::filesystem;
+
+using std::string;
+using std::vector;
+
+std::atomic<size_t> allocations{};
+
+struct Parsed {
+    vector<string> to;
+    string         content;
+};
+
+// the parsing of process_file() before the spool_file module, as it was:
+// the first To line only, split at its last ':', the logged errors throw
+Parsed legacy_parse(const fs::path& file) {
+    std::ifstream in_file{file};
+    if (!in_file) throw std::runtime_error{"unable to open file"};
+
+    std::stringstream content{};
+    string            phone_number{};
+    string            line{};
+    while (!(line.starts_with("To") || line.starts_with("to"))) {
+        line.clear();
+        if (!std::getline(in_file, line)) break;
+    }
+    if (line.empty()) throw std::runtime_error{"no To field specified in file"};
+    if (const auto i = line.find_last_of(':'); i > 0) {
+        if (i + 1 < line.size()) {
+            phone_number = line.substr(i + 1);
+            trim(phone_number);
+        } else {
+            throw std::runtime_error{"no value in to field (empty)"};
+        }
+    } else {
+        throw std::runtime_error{"no separator ':' specified in To field"};
+    }
+
+    line.clear();
+    while (std::getline(in_file, line) && !line.empty()) line.clear();
+
+    content << in_file.rdbuf();
+    return {{std::move(phone_number)}, std::move(content).str()};
+}
+
+Parsed spool_parse(const fs::path& file) {
+    Parsed     res{};
+    auto       text  = spool::read_spool_file(file, 1 << 20);
+    const auto spool = spool::parse_spool_file(text);
+    res.to.assign(spool.to.begin(), spool.to.end());
+    res.content = spool::take_body(std::move(text), spool);
+    return res;
+}
+
+struct Case {
+    const char* name;
+    string      text;
+};
+
+vector<Case> cases() {
+    const auto headers = [](size_t recipients) {
+        string h{};
+        for (size_t i{}; i < recipients; ++i)
+            h += fmt::format("To: 3620{:07}\n", i);
+        return h;
+    };
+    const string smsd =
+        "From: checkmk\nFlash: no\nAlphabet: UTF-8\nPriority: high\n"
+        "Report: yes\nValidity: 1d\nAutosplit: 3\n";
+    const string alert =
+        "CRIT - db01/Filesystem /var: 97.1% used (48.5 of 50.0 GB)\n";
+
+    return {
+        {"short", headers(1) + "\n" + alert},
+        {"smsd headers", headers(10) + smsd + "\n" + alert},
+        {"long body", headers(1) + "\n" + string(30000, 'x')},
+    };
+}
+
+template <typename Parse>
+void run(const char* parser, const fs::path& file, size_t iterations,
+         Parse parse) {
+    using clock = std::chrono::steady_clock;
+
+    size_t check{};
+    allocations    = 0;
+    const auto beg = clock::now();
+    for (size_t i{}; i < iterations; ++i) {
+        const auto res = parse(file);
+        check += res.to.size() + res.content.size();
+    }
+    const auto ns =
+        std::chrono::duration<double, std::nano>(clock::now() - beg);
+
+    fmt::print("  {:<8} {:>10.0f} ns/op {:>8.1f} allocs/op  ({})\n", parser,
+               ns.count() / static_cast<double>(iterations),
+               static_cast<double>(allocations) /
+                   static_cast<double>(iterations),
+               check / iterations);
+}
+}  // namespace
+
+// gcc takes the replaced operators for a malloc/delete mismatch
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (auto* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, const char* argv[]) {
+    const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 20000;
+
+    const auto dir = fs::temp_directory_path() /
+                     fmt::format("asmsd-bench-spool-{}", ::getpid());
+    fs::create_directories(dir);
+
+    for (const auto& [name, text] : cases()) {
+        const auto file = dir / "sms";
+        std::ofstream{file, std::ios::binary} << text;
+
+        fmt::print("{} ({} bytes)\n", name, text.size());
+        run("getline", file, iterations, legacy_parse);
+        run("spool", file, iterations, spool_parse);
+    }
+    fs::remove_all(dir);
+}
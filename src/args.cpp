@@ -26,6 +26,7 @@ struct Args::_Repr {
     bool           sms_contact_list;
     int            sms_content_list;
     size_t         page;
+    bool           all_pages;
     vector<string> send_sms;
     string         content;
     int            delete_sms;
@@ -34,6 +35,34 @@ struct Args::_Repr {
     seconds        time_out;
     seconds        keep_alive;
     minutes        reprocess;
+    bool           session;
+    vector<string> devices;
+    fs::path       journal;
+    seconds        aging;
+    seconds        coalesce;
+    size_t         digest_segments;
+    seconds        fanout;
+    size_t         max_recipients;
+    size_t         max_segments;
+    string         over_length;
+    size_t         max_file_size;
+    bool           reactor;
+    fs::path       checkpoint;
+    size_t         intake_queue;
+    size_t         parsers;
+    int            metrics_port;
+    fs::path       trace;
+    fs::path       record;
+    fs::path       replay;
+    double         replay_speed;
+    fs::path       receive;
+    fs::path       receive_state;
+    seconds        receive_interval;
+    fs::path       mirror;
+    bool           sync;
+    string         search;
+    string         phone;
+    minutes        since;
 };
 
 Args::Args()  = default;
@@ -54,6 +83,11 @@ void Args::parse(int argc, const char* argv[]) {
     long   time_out{};
     long   keep_alive{};
     long   reprocess{};
+    long   aging{};
+    long   coalesce{};
+    long   fanout{};
+    long   receive_interval{};
+    long   since{};
 
     opts.set_width(90).add_options()  //
         ("l,log-level", "log level", value(log_level)->default_value("info"))(
@@ -68,7 +102,11 @@ void Args::parse(int argc, const char* argv[]) {
             "t,time-out", "connection time out in seconds",
             value(time_out)->default_value("9"))(
             "k,keep-alive", "keep alive timer in seconds",
-            value(keep_alive)->default_value("3"))("help", "print usage");
+            value(keep_alive)->default_value("3"))(
+            "session", "reuse one keep-alive connection for all requests",
+            value(_repr->session)->default_value("true"))(
+            "D,device", "additional dongle to send with: host[:port[:token]]",
+            value(_repr->devices))("help", "print usage");
 
     opts.add_options("commands")  //
         ("system-info", "show system informations", value(_repr->system_info))(
@@ -84,6 +122,8 @@ void Args::parse(int argc, const char* argv[]) {
                                             value(_repr->sms_content_list))(
             "n,page", "specify the page number",
             value(_repr->page)->default_value("1"))(
+            "all-pages", "show every page of a list from --page on",
+            value(_repr->all_pages))(
             "d,detailed", "show information views in deatiled mode",
             value(_repr->detailed))("send-sms", "sending sms to phone numbers",
                                     value(_repr->send_sms))(
@@ -96,7 +136,59 @@ void Args::parse(int argc, const char* argv[]) {
             "m,move-to", "move sended file to this directory",
             value(_repr->move_to)->implicit_value("."))(
             "r,reprocess", "reprocess files which created arg minutes ago",
-            value(reprocess)->default_value("5"));
+            value(reprocess)->default_value("5"))(
+            "j,journal", "journal file of the watched files, replayed on start",
+            value(_repr->journal))(
+            "aging", "seconds waited to raise a queued SMS priority class",
+            value(aging)->default_value("30"))(
+            "coalesce", "seconds to merge SMSes to a recipient into a digest",
+            value(coalesce)->default_value("0"))(
+            "digest-segments", "SMS segments a digest is cut to",
+            value(_repr->digest_segments)->default_value("3"))(
+            "fanout", "seconds to merge the same text to more recipients",
+            value(fanout)->default_value("0"))(
+            "max-recipients", "phone numbers the dongle takes in one request",
+            value(_repr->max_recipients)->default_value("10"))(
+            "max-segments", "SMS segments a text may take, 0 is unlimited",
+            value(_repr->max_segments)->default_value("0"))(
+            "over-length", "longer texts are: send, truncate, split or reject",
+            value(_repr->over_length)->default_value("truncate"))(
+            "max-file-size", "bytes a spool file may take, bigger are refused",
+            value(_repr->max_file_size)->default_value("65536"))(
+            "reactor", "watch with one epoll loop instead of threads",
+            value(_repr->reactor))(
+            "checkpoint", "file of the last taken file, reprocessed from there",
+            value(_repr->checkpoint))(
+            "intake-queue", "watched files waiting for the parsers",
+            value(_repr->intake_queue)->default_value("1024"))(
+            "parsers", "threads reading the watched files",
+            value(_repr->parsers)->default_value("2"))(
+            "metrics-port", "serve prometheus metrics on localhost, 0 is off",
+            value(_repr->metrics_port)->default_value("0"))(
+            "trace", "file of the per message stage timings, json lines",
+            value(_repr->trace))(
+            "record", "file to record the dongle rpc traffic into",
+            value(_repr->record))(
+            "replay", "recorded rpc traffic answering instead of the dongle",
+            value(_repr->replay))(
+            "replay-speed", "pace of the replay, 0 answers at once",
+            value(_repr->replay_speed)->default_value("1"))(
+            "receive", "write the received SMSes into this directory",
+            value(_repr->receive))(
+            "receive-state", "file of the received SMS ids, kept on restart",
+            value(_repr->receive_state))(
+            "receive-interval", "seconds between polls for received SMSes",
+            value(receive_interval)->default_value("10"))(
+            "mirror", "file of the local SMS mirror answering the lists",
+            value(_repr->mirror))(
+            "sync", "bring the mirror up to date with the dongle first",
+            value(_repr->sync))(
+            "search", "show the mirrored SMSes containing this text",
+            value(_repr->search))(
+            "phone", "show the mirrored SMSes of this phone number",
+            value(_repr->phone))(
+            "since", "show the mirrored SMSes of the last minutes, 0 is all",
+            value(since)->default_value("0"));
 
     auto result = std::make_unique<ParseResult>(opts.parse(argc, argv));
 
@@ -110,11 +202,19 @@ void Args::parse(int argc, const char* argv[]) {
     trim(_repr->base_path);
     trim(_repr->verify_token);
     trim(_repr->content);
+    trim(_repr->over_length);
+    trim(_repr->phone);
 
     _repr->log_level  = spdlog::level::from_str(log_level);
     _repr->time_out   = seconds{time_out};
     _repr->keep_alive = seconds{keep_alive};
     _repr->reprocess  = minutes{reprocess};
+    _repr->aging      = seconds{aging};
+    _repr->coalesce   = seconds{coalesce};
+    _repr->fanout     = seconds{fanout};
+
+    _repr->receive_interval = seconds{receive_interval};
+    _repr->since            = minutes{since};
 }
 
 Args::vector<Args::string>&& Args::send_sms() && noexcept {
@@ -165,6 +265,7 @@ const int& Args::sms_content_list() const& noexcept {
     return _repr->sms_content_list;
 }
 const size_t& Args::page() const& noexcept { return _repr->page; }
+const bool& Args::all_pages() const& noexcept { return _repr->all_pages; }
 const Args::vector<Args::string>& Args::send_sms() const& noexcept {
     return _repr->send_sms;
 }
@@ -181,4 +282,58 @@ const Args::seconds& Args::keep_alive() const& noexcept {
 const Args::minutes& Args::reprocess() const& noexcept {
     return _repr->reprocess;
 }
+const bool& Args::session() const& noexcept { return _repr->session; }
+const Args::vector<Args::string>& Args::devices() const& noexcept {
+    return _repr->devices;
+}
+const fs::path& Args::journal() const& noexcept { return _repr->journal; }
+const Args::seconds& Args::aging() const& noexcept { return _repr->aging; }
+const Args::seconds& Args::coalesce() const& noexcept {
+    return _repr->coalesce;
+}
+const size_t& Args::digest_segments() const& noexcept {
+    return _repr->digest_segments;
+}
+const Args::seconds& Args::fanout() const& noexcept { return _repr->fanout; }
+const size_t& Args::max_recipients() const& noexcept {
+    return _repr->max_recipients;
+}
+const size_t& Args::max_segments() const& noexcept {
+    return _repr->max_segments;
+}
+const Args::string& Args::over_length() const& noexcept {
+    return _repr->over_length;
+}
+const size_t& Args::max_file_size() const& noexcept {
+    return _repr->max_file_size;
+}
+const bool& Args::reactor() const& noexcept { return _repr->reactor; }
+const fs::path& Args::checkpoint() const& noexcept {
+    return _repr->checkpoint;
+}
+const size_t& Args::intake_queue() const& noexcept {
+    return _repr->intake_queue;
+}
+const size_t& Args::parsers() const& noexcept { return _repr->parsers; }
+const int& Args::metrics_port() const& noexcept {
+    return _repr->metrics_port;
+}
+const fs::path& Args::trace() const& noexcept { return _repr->trace; }
+const fs::path& Args::record() const& noexcept { return _repr->record; }
+const fs::path& Args::replay() const& noexcept { return _repr->replay; }
+const double& Args::replay_speed() const& noexcept {
+    return _repr->replay_speed;
+}
+const fs::path& Args::receive() const& noexcept { return _repr->receive; }
+const fs::path& Args::receive_state() const& noexcept {
+    return _repr->receive_state;
+}
+const Args::seconds& Args::receive_interval() const& noexcept {
+    return _repr->receive_interval;
+}
+const fs::path& Args::mirror() const& noexcept { return _repr->mirror; }
+const bool&     Args::sync() const& noexcept { return _repr->sync; }
+const Args::string& Args::search() const& noexcept { return _repr->search; }
+const Args::string& Args::phone() const& noexcept { return _repr->phone; }
+const Args::minutes& Args::since() const& noexcept { return _repr->since; }
 }  // namespace aux
\ No newline at end of file
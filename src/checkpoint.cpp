@@ -0,0 +1,151 @@
+#include "checkpoint.hpp"
+
+#include <sys/stat.h>
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "fmt/core.h"
+#include "fmt/format.h"
+
+namespace {
+using std::chrono::steady_clock;
+
+constexpr auto SAVE_INTERVAL = std::chrono::seconds{1};
+}  // namespace
+
+namespace spool {
+
+std::optional<FileStamp> stamp_of(const fs::path& file) noexcept {
+    struct stat st {};
+    if (::stat(file.c_str(), &st) != 0) return std::nullopt;
+    return FileStamp{
+        static_cast<std::int64_t>(st.st_ctim.tv_sec) * 1'000'000'000 +
+            st.st_ctim.tv_nsec,
+        static_cast<std::uint64_t>(st.st_ino)};
+}
+
+struct Checkpoint::_Impl {
+    fs::path                      _file;
+    std::int64_t                  _ctime;
+    std::set<std::uint64_t>       _inodes;  // done files of the newest ctime
+    std::map<fs::path, FileStamp> _taken;   // queued, not done yet
+    bool                          _empty;
+    bool                          _dirty;
+    bool                          _held;
+    steady_clock::time_point      _saved;
+    std::mutex                    _mutex;
+
+    explicit _Impl(fs::path file)
+        : _file(std::move(file)),
+          _ctime{},
+          _empty{true},
+          _dirty{},
+          _held{} {}
+
+    void load();
+    void save();
+};
+
+// first line the ctime, then an inode per line; a broken file is taken
+// as no checkpoint, the reprocess window covers that case
+void Checkpoint::_Impl::load() {
+    std::ifstream in{_file};
+    if (!in || !(in >> _ctime)) return;
+    std::uint64_t inode{};
+    while (in >> inode) _inodes.insert(inode);
+    _empty = false;
+}
+
+// the newest done file, or just the oldest taken one when that is older
+void Checkpoint::_Impl::save() {
+    auto ctime  = _ctime;
+    bool before = false;
+    for (const auto& [file, stamp] : _taken)
+        if (stamp.ctime < ctime) {
+            ctime  = stamp.ctime;
+            before = true;
+        }
+
+    auto tmp = _file;
+    tmp += ".tmp";
+    {
+        std::ofstream out{tmp, std::ios::trunc};
+        if (before)
+            out << fmt::format("{}\n", ctime);
+        else
+            out << fmt::format("{}\n{}\n", ctime, fmt::join(_inodes, "\n"));
+        if (!out.flush()) throw std::runtime_error{"checkpoint write"};
+    }
+    fs::rename(tmp, _file);
+    _dirty = false;
+    _saved = steady_clock::now();
+}
+
+Checkpoint::Checkpoint(fs::path file)
+    : _impl(std::make_unique<_Impl>(std::move(file))) {
+    _impl->load();
+}
+
+Checkpoint::Checkpoint(Checkpoint&&) noexcept = default;
+
+Checkpoint::~Checkpoint() = default;
+
+bool Checkpoint::empty() {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    return _impl->_empty;
+}
+
+bool Checkpoint::covers(const FileStamp& stamp) {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    if (_impl->_empty) return false;
+    return stamp.ctime < _impl->_ctime ||
+           (stamp.ctime == _impl->_ctime && _impl->_inodes.count(stamp.inode));
+}
+
+void Checkpoint::take(const fs::path& file, const FileStamp& stamp) {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    _impl->_taken.insert_or_assign(file, stamp);
+}
+
+void Checkpoint::advance(const fs::path& file) {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    const auto it = _impl->_taken.find(file);
+    if (it == _impl->_taken.end()) return;
+    const auto stamp = it->second;
+    _impl->_taken.erase(it);
+
+    // an older done file may still let the saved checkpoint move on
+    _impl->_dirty = true;
+    if (_impl->_empty || stamp.ctime > _impl->_ctime) {
+        _impl->_ctime = stamp.ctime;
+        _impl->_inodes.clear();
+        _impl->_empty = false;
+    }
+    if (stamp.ctime == _impl->_ctime) _impl->_inodes.insert(stamp.inode);
+    if (_impl->_dirty && !_impl->_held &&
+        steady_clock::now() - _impl->_saved >= SAVE_INTERVAL)
+        _impl->save();
+}
+
+void Checkpoint::save() {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    if (_impl->_dirty && !_impl->_held) _impl->save();
+}
+
+void Checkpoint::hold() {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    _impl->_held = true;
+}
+
+void Checkpoint::release() {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    _impl->_held = false;
+    if (_impl->_dirty) _impl->save();
+}
+
+}  // namespace spool
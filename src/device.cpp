@@ -1,8 +1,12 @@
 #include "device.hpp"
 
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <mutex>
 #include <string_view>
 
+#include "fmt/core.h"
 #include "httpclientconnector.hpp"
 #include "jsonrpccxx/client.hpp"
 #include "messages_aux.hpp"
@@ -14,31 +18,137 @@ using std::chrono::steady_clock;
 using time_point = steady_clock::time_point;
 
 using namespace std::chrono_literals;
+
+constexpr auto SEND_POLL_INTERVAL = 1s;
+
+// failed batches in a row before the device is taken as not batching
+constexpr int BATCH_FAILURES = 3;
 }  // namespace
 
 namespace messages {
 
+namespace {
+/// errors as the json rpc client reports them
+bool decode(std::string_view body, std::uint32_t first_id,
+            std::initializer_list<aux::view_ptr> views) {
+    try {
+        return aux::decode(body, first_id, views);
+    } catch (const aux::rpc_error& e) {
+        throw jsonrpccxx::JsonRpcException(e.code, e.what());
+    } catch (const std::invalid_argument& e) {
+        throw jsonrpccxx::JsonRpcException(jsonrpccxx::parse_error, e.what());
+    }
+}
+}  // namespace
+
 struct Device::_Impl {
     using Connector = staff::HttpClientConnector;
 
     Connector       _connector;
     version         _version;
+    JsonRpcClient   _client;
     seconds         _keepalive;
     time_point      _last_alive;
-    SystemInfo      _sys_inf;
-    SystemStatus    _sys_status;
-    ConnectionState _con_state;
-    SmsStorageState _sms_state;
-    SmsContactList  _contacts;
-    SmsContentList  _contents;
     std::mutex      _mutex;
     bool            _is_running;
+    bool            _batch;
+    int             _batch_failures;
+    std::uint32_t   _last_id;
+
+    /// one SMS on its way to the dongle, the sender thread steps it
+    /// from SUBMIT through POLL to DONE with one rpc per step
+    struct Outgoing {
+        enum Stage : std::uint8_t { SUBMIT, POLL, DONE };
+
+        SendSms                     sms;
+        std::promise<SendSmsResult> promise;
+        Stage                       state;
+        time_point                  next_poll;
+        std::shared_ptr<SendTimes>  times;
+    };
+
+    std::mutex              _send_mutex;
+    std::condition_variable _send_cv;
+    std::deque<Outgoing>    _outgoing;
+    std::thread             _sender;
+    bool                    _stopping;
+
+    // swapped under its own lock, libc++ has no atomic<shared_ptr>; it is
+    // held only to copy the pointer
+    mutable std::mutex _state_mutex;
+    StatePtr           _state;
 
     _Impl(Connector con, version ver, seconds kal)
-        : _connector(std::move(con)), _version(ver), _keepalive(kal) {}
+        : _connector(std::move(con)),
+          _version(ver),
+          _client(_connector, _version),
+          _keepalive(kal),
+          _batch(ver == version::v2),
+          _batch_failures{},
+          _last_id{},
+          _stopping{},
+          _state(std::make_shared<const State>()) {}
+
+    ~_Impl();
 
     bool ensure_alive();
     bool is_alive();
+
+    inline string next_id() { return std::to_string(++_last_id); }
+
+    inline aux::json call(const char* method) {
+        return _client.CallMethod<aux::json>(next_id(), method);
+    }
+
+    /// the request of a method without parameters, as the client sends it
+    string request(const char* method) {
+        return fmt::format(R"({{{}"method":"{}","id":"{}","params":[]}})",
+                           _version == version::v2 ? R"("jsonrpc":"2.0",)" : "",
+                           method, next_id());
+    }
+
+    /// the response body is streamed straight into the view, no json tree
+    /// is built for it
+    template <typename T>
+    std::shared_ptr<T> fetch() {
+        const auto first = _last_id + 1;
+        const auto body  = _connector.Send(request(aux::query_str<T>()));
+        auto       view  = std::make_shared<T>();
+        if (!decode(body, first, {view.get()}))
+            throw jsonrpccxx::JsonRpcException(
+                jsonrpccxx::internal_error,
+                "invalid server response: id mismatch");
+        return view;
+    }
+
+    /// false when the batch was not answered as one, the views are then
+    /// fetched one by one; batches are not tried again once the firmware
+    /// turns out not to support them
+    bool fetch_batch(std::initializer_list<const char*>   methods,
+                     std::initializer_list<aux::view_ptr> views);
+
+    void run_sender();
+    void step(Outgoing& out);
+
+    StatePtr load_state() const {
+        std::lock_guard<std::mutex> lock(_state_mutex);
+        return _state;
+    }
+
+    /// copy on write: writers are serialized by _mutex, readers only
+    /// load the published pointer and never wait for a running rpc
+    template <typename Update>
+    StatePtr publish(Update&& update) {
+        auto next = std::make_shared<State>(*load_state());
+        update(*next);
+        ++next->version;
+        next->updated = steady_clock::now();
+
+        StatePtr res = std::move(next);
+        std::lock_guard<std::mutex> lock(_state_mutex);
+        _state = res;
+        return res;
+    }
 };
 
 Device::Device(string hostname, int port, string base_path, seconds keepalive,
@@ -60,10 +170,18 @@ Device::Device(Device&& other) noexcept {
 
 Device::~Device() = default;
 
+Device::_Impl::~_Impl() {
+    {
+        std::lock_guard<std::mutex> lock(_send_mutex);
+        _stopping = true;
+    }
+    _send_cv.notify_all();
+    if (_sender.joinable()) _sender.join();
+}
+
 bool Device::_Impl::ensure_alive() {
     try {
-        auto       client = JsonRpcClient{_connector, _version};
-        const auto res    = client.CallMethod<aux::json>("0", "HeartBeat");
+        const auto res = call("HeartBeat");
     } catch (const std::runtime_error& e) {
         const auto what = string_view{e.what()};
         if (what.starts_with("connection error: "))
@@ -113,6 +231,11 @@ void Device::wait_alive() {
     }
 }
 
+bool Device::heartbeat() {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    return _impl->ensure_alive();
+}
+
 bool Device::is_running() {
     std::lock_guard<std::mutex> lock(_impl->_mutex);
     return _impl->_is_running;
@@ -123,78 +246,145 @@ void Device::set_default_headers(HeadersInit hdrs) {
     _impl->_connector.set_default_headers(std::move(hdrs));
 }
 
-const SystemInfo& Device::system_info() {
+void Device::session(bool enabled) {
     std::lock_guard<std::mutex> lock(_impl->_mutex);
-
-    if (_impl->is_alive()) {
-        auto client = JsonRpcClient{_impl->_connector, _impl->_version};
-        aux::emplace_json(
-            _impl->_sys_inf,
-            client.CallMethod<aux::json>("1", aux::query_str<SystemInfo>()));
-    }
-    return _impl->_sys_inf;
+    _impl->_connector.session(enabled);
 }
 
-const SystemStatus& Device::system_status() {
+Device::ConnectionStats Device::connection_stats() {
     std::lock_guard<std::mutex> lock(_impl->_mutex);
+    return _impl->_connector.stats();
+}
 
-    if (_impl->is_alive()) {
-        auto client = JsonRpcClient{_impl->_connector, _impl->_version};
-        aux::emplace_json(
-            _impl->_sys_status,
-            client.CallMethod<aux::json>("2", aux::query_str<SystemStatus>()));
-    }
-    return _impl->_sys_status;
+void Device::record(staff::Recorder* recorder) {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    _impl->_connector.record(recorder);
 }
 
-const ConnectionState& Device::connection_state() {
+void Device::replay(staff::Replay* replay) {
     std::lock_guard<std::mutex> lock(_impl->_mutex);
+    _impl->_connector.replay(replay);
+}
 
-    if (_impl->is_alive()) {
-        auto client = JsonRpcClient{_impl->_connector, _impl->_version};
-        aux::emplace_json(_impl->_con_state,
-                          client.CallMethod<aux::json>(
-                              "3", aux::query_str<ConnectionState>()));
+Device::View<SystemInfo> Device::system_info() const {
+    return _impl->load_state()->system_info;
+}
+
+Device::View<SystemStatus> Device::system_status() const {
+    return _impl->load_state()->system_status;
+}
+
+Device::View<ConnectionState> Device::connection_state() const {
+    return _impl->load_state()->connection_state;
+}
+
+Device::View<SmsStorageState> Device::sms_storage_state() const {
+    return _impl->load_state()->sms_storage_state;
+}
+
+Device::StatePtr Device::state() const { return _impl->load_state(); }
+
+bool Device::_Impl::fetch_batch(std::initializer_list<const char*>   methods,
+                                std::initializer_list<aux::view_ptr> views) {
+    const auto first = _last_id + 1;
+    string     req{"["};
+    for (const auto* method : methods) {
+        if (req.size() > 1) req += ',';
+        req += request(method);
     }
-    return _impl->_con_state;
+    req += ']';
+
+    // a single error, missing, null, duplicate or reordered ids: the
+    // firmware does not answer batches
+    try {
+        if (aux::decode(_connector.Send(req), first, views)) {
+            _batch_failures = 0;
+            return true;
+        }
+        _batch = false;
+        return false;
+    } catch (const std::invalid_argument&) {
+        _batch = false;
+        return false;
+    } catch (const jsonrpccxx::JsonRpcException&) {
+        // non 200 http status, may be transient
+    } catch (const aux::rpc_error&) {
+        // an error element, the single calls tell if it is real
+    }
+    if (++_batch_failures >= BATCH_FAILURES) _batch = false;
+    return false;
 }
 
-const SmsStorageState& Device::sms_storage_state() {
+Device::StatePtr Device::snapshot() {
     std::lock_guard<std::mutex> lock(_impl->_mutex);
 
-    if (_impl->is_alive()) {
-        auto       client = JsonRpcClient{_impl->_connector, _impl->_version};
-        const auto repl   = client.CallMethod<aux::json>(
-            "4", aux::query_str<SmsStorageState>());
-        aux::from_json(repl, _impl->_sms_state);
+    if (!_impl->is_alive()) return _impl->load_state();
+
+    // the system info does not change, it is fetched with the first one
+    auto sys_info = _impl->load_state()->system_info;
+    if (!sys_info) sys_info = _impl->fetch<SystemInfo>();
+
+    auto sys_status = std::make_shared<SystemStatus>();
+    auto con_state  = std::make_shared<ConnectionState>();
+    auto sms_state  = std::make_shared<SmsStorageState>();
+    if (!_impl->_batch ||
+        !_impl->fetch_batch({aux::query_str<SystemStatus>(),
+                             aux::query_str<ConnectionState>(),
+                             aux::query_str<SmsStorageState>()},
+                            {sys_status.get(), con_state.get(),
+                             sms_state.get()})) {
+        sys_status = _impl->fetch<SystemStatus>();
+        con_state  = _impl->fetch<ConnectionState>();
+        sms_state  = _impl->fetch<SmsStorageState>();
     }
-    return _impl->_sms_state;
+    _impl->_last_alive = steady_clock::now();
+
+    return _impl->publish([&](State& s) {
+        s.system_info       = std::move(sys_info);
+        s.system_status     = std::move(sys_status);
+        s.connection_state  = std::move(con_state);
+        s.sms_storage_state = std::move(sms_state);
+    });
 }
 
-const SmsContactList& Device::sms_contacts(size_t page) {
+SmsContactList Device::sms_contacts(size_t page) {
     std::lock_guard<std::mutex> lock(_impl->_mutex);
 
+    SmsContactList contacts{};
     if (_impl->is_alive()) {
-        auto client      = JsonRpcClient{_impl->_connector, _impl->_version};
-        _impl->_contacts = client.CallMethodNamed<SmsContactList>(
-            "5", aux::query_str<SmsContactList>(),
+        auto& client = _impl->_client;
+        contacts     = client.CallMethodNamed<SmsContactList>(
+            _impl->next_id(), aux::query_str<SmsContactList>(),
             aux::as_param(Page(page > 0 ? page - 1 : 0)));
         _impl->_last_alive = steady_clock::now();
     }
-    return _impl->_contacts;
+    return contacts;
 }
 
-const SmsContentList& Device::sms_contents(int contact, size_t page) {
+SmsContentList Device::sms_contents(int contact, size_t page) {
     std::lock_guard<std::mutex> lock(_impl->_mutex);
 
+    SmsContentList contents{};
     if (_impl->is_alive()) {
-        auto client      = JsonRpcClient{_impl->_connector, _impl->_version};
-        _impl->_contents = client.CallMethodNamed<SmsContentList>(
-            "6", aux::query_str<SmsContentList>(),
+        auto& client = _impl->_client;
+        contents     = client.CallMethodNamed<SmsContentList>(
+            _impl->next_id(), aux::query_str<SmsContentList>(),
             aux::as_param(GetSmsContentList(contact, page > 0 ? page - 1 : 0)));
         _impl->_last_alive = steady_clock::now();
     }
-    return _impl->_contents;
+    return contents;
+}
+
+Device::Pages<SmsContactList> Device::all_sms_contacts(size_t first) {
+    return {[this](size_t page) { return sms_contacts(page); }, first};
+}
+
+Device::Pages<SmsContentList> Device::all_sms_contents(int contact,
+                                                       size_t first) {
+    return {[this, contact](size_t page) {
+                return sms_contents(contact, page);
+            },
+            first};
 }
 
 static constexpr auto WORKAROUND =
@@ -204,9 +394,9 @@ void Device::delete_sms(int contact, int sms) {
     std::lock_guard<std::mutex> lock(_impl->_mutex);
 
     if (_impl->is_alive()) try {
-            auto client = JsonRpcClient{_impl->_connector, _impl->_version};
+            auto& client = _impl->_client;
             client.CallMethodNamed<aux::json>(
-                "7", DeleteSms::query_str,
+                _impl->next_id(), DeleteSms::query_str,
                 aux::as_param(sms > 0 ? DeleteSms(contact, sms)
                                       : DeleteSms(contact)));
         } catch (const jsonrpccxx::JsonRpcException& je) {
@@ -216,28 +406,99 @@ void Device::delete_sms(int contact, int sms) {
         }
 }
 
-SendSmsResult Device::send_sms(vector<string> nums, string content) {
-    std::lock_guard<std::mutex> lock(_impl->_mutex);
+void Device::_Impl::step(Outgoing& out) {
+    std::lock_guard<std::mutex> lock(_mutex);
 
-    if (_impl->is_alive()) {
-        auto client = JsonRpcClient{_impl->_connector, _impl->_version};
-        client.CallMethodNamed<aux::json>(
-            "8", aux::query_str<SendSms>(),
-            aux::as_param(SendSms(std::move(nums), std::move(content))));
-
-        auto res = client.CallMethod<SendSmsResult>(
-            "9", aux::query_str<SendSmsResult>());
-
-        if (res.send_status == SendSmsResult::SENDING) {
-            while (res.send_status == SendSmsResult::SENDING) {
-                std::this_thread::sleep_for(1s);
-                res = client.CallMethod<SendSmsResult>(
-                    "10", aux::query_str<SendSmsResult>());
+    switch (out.state) {
+        case Outgoing::SUBMIT:
+            if (!is_alive()) {
+                out.promise.set_value(SendSmsResult{SendSmsResult::FAILED});
+                out.state = Outgoing::DONE;
+                break;
             }
+            _client.CallMethodNamed<aux::json>(
+                next_id(), aux::query_str<SendSms>(),
+                aux::as_param(std::move(out.sms)));
+            out.state     = Outgoing::POLL;
+            out.next_poll = steady_clock::now();
+            if (out.times) out.times->posted = out.next_poll;
+            break;
+        case Outgoing::POLL: {
+            auto res = _client.CallMethod<SendSmsResult>(
+                next_id(), aux::query_str<SendSmsResult>());
+            _last_alive = steady_clock::now();
+            if (out.times && out.times->polled == time_point{})
+                out.times->polled = _last_alive;
+            if (res.send_status == SendSmsResult::SENDING) {
+                out.next_poll = _last_alive + SEND_POLL_INTERVAL;
+                break;
+            }
+            out.promise.set_value(res);
+            out.state = Outgoing::DONE;
+        } break;
+        case Outgoing::DONE:
+            break;
+    }
+}
+
+void Device::_Impl::run_sender() {
+    std::unique_lock<std::mutex> lock(_send_mutex);
+    for (;;) {
+        _send_cv.wait(lock, [this] { return _stopping || !_outgoing.empty(); });
+        if (_stopping) break;
+
+        // references into a deque survive push_back from other threads
+        auto& out = _outgoing.front();
+        if (out.state == Outgoing::POLL &&
+            _send_cv.wait_until(lock, out.next_poll,
+                                [this] { return _stopping; }))
+            break;
+
+        // the device lock is held only for the rpc of one step
+        lock.unlock();
+        const auto stage = out.state;
+        try {
+            step(out);
+        } catch (...) {
+            out.promise.set_exception(std::current_exception());
+            out.state = Outgoing::DONE;
         }
-        return res;
+        // before the result is polled, so it is ready after the hook ran
+        if (stage == Outgoing::SUBMIT && out.state == Outgoing::POLL &&
+            out.times && out.times->on_posted)
+            out.times->on_posted();
+        lock.lock();
+        if (out.state == Outgoing::DONE) _outgoing.pop_front();
     }
-    return SendSmsResult{SendSmsResult::FAILED};
+    for (auto& out : _outgoing)
+        out.promise.set_value(SendSmsResult{SendSmsResult::FAILED});
+    _outgoing.clear();
+}
+
+Device::SendFuture Device::send_sms_async(vector<string> nums, string content,
+                                          std::shared_ptr<SendTimes> times) {
+    std::lock_guard<std::mutex> lock(_impl->_send_mutex);
+
+    auto& out = _impl->_outgoing.emplace_back(
+        SendSms(std::move(nums), std::move(content)),
+        std::promise<SendSmsResult>{}, _Impl::Outgoing::SUBMIT, time_point{},
+        std::move(times));
+    auto res = out.promise.get_future();
+
+    if (!_impl->_sender.joinable())
+        _impl->_sender =
+            std::thread([impl = _impl.get()] { impl->run_sender(); });
+    _impl->_send_cv.notify_one();
+    return res;
+}
+
+SendSmsResult Device::send_sms(vector<string> nums, string content) {
+    return send_sms_async(std::move(nums), std::move(content)).get();
+}
+
+size_t Device::pending_sms() {
+    std::lock_guard<std::mutex> lock(_impl->_send_mutex);
+    return _impl->_outgoing.size();
 }
 
 }  // namespace messages
\ No newline at end of file
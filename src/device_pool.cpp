@@ -0,0 +1,195 @@
+#include "device_pool.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "metrics.hpp"
+
+namespace messages {
+
+struct DevicePool::_Impl {
+    struct Member {
+        std::unique_ptr<Device> device;
+        bool                    online;
+        bool                    full;
+        metrics::Counter*       heartbeat_failures;
+        metrics::Counter*       went_online;
+        metrics::Counter*       went_offline;
+        metrics::Gauge*         signal_strength;
+    };
+
+    vector<Member>          _members;
+    seconds                 _keepalive;
+    size_t                  _next;
+    std::mutex              _mutex;
+    std::condition_variable _cv;
+    bool                    _is_running;
+    bool                    _stopped;
+
+    explicit _Impl(seconds kal)
+        : _keepalive(kal), _next{}, _is_running{}, _stopped{} {}
+
+    static inline bool healthy(const Member& m) noexcept {
+        return m.online && !m.full;
+    }
+
+    bool any_healthy() const noexcept {
+        return std::any_of(_members.begin(), _members.end(), healthy);
+    }
+
+    Member& select();
+};
+
+DevicePool::DevicePool(seconds keepalive)
+    : _impl(std::make_unique<_Impl>(keepalive)) {}
+
+DevicePool::DevicePool(DevicePool&& other) noexcept = default;
+
+DevicePool::~DevicePool() = default;
+
+Device& DevicePool::add(std::unique_ptr<Device> device) {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+
+    auto&      reg   = metrics::registry();
+    const auto index = std::to_string(_impl->_members.size());
+    const auto state = [&](std::string_view to) {
+        return &reg.counter("asmsd_device_transitions_total",
+                            "dongle went online or offline",
+                            {{"device", index}, {"to", to}});
+    };
+    return *_impl->_members
+                .emplace_back(
+                    std::move(device), true, false,
+                    &reg.counter("asmsd_heartbeat_failures_total",
+                                 "keepalive requests the dongle failed",
+                                 {{"device", index}}),
+                    state("online"), state("offline"),
+                    &reg.gauge("asmsd_signal_strength",
+                               "signal strength the dongle last reported",
+                               {{"device", index}}))
+                .device;
+}
+
+Device& DevicePool::primary() { return at(0); }
+
+Device& DevicePool::at(size_t i) {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    return *_impl->_members.at(i).device;
+}
+
+size_t DevicePool::size() const noexcept { return _impl->_members.size(); }
+
+size_t DevicePool::in_rotation() {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    size_t n{};
+    for (const auto& m : _impl->_members) n += _Impl::healthy(m);
+    return n;
+}
+
+// least outstanding work among the healthy members, ties are broken round
+// robin; an offline or full dongle would only fail or hold the message, so
+// the caller waits for one to come back
+DevicePool::_Impl::Member& DevicePool::_Impl::select() {
+    if (_members.empty()) throw std::logic_error{"device pool is empty"};
+
+    Member* best{};
+    size_t  best_load{};
+    for (size_t k{}; k < _members.size(); ++k) {
+        auto& m = _members[(_next + k) % _members.size()];
+        if (!healthy(m)) continue;
+        const auto load = m.device->pending_sms();
+        if (!best || load < best_load) {
+            best      = &m;
+            best_load = load;
+        }
+    }
+    if (!best) throw NotInRotation{};
+    _next = (_next + 1) % _members.size();
+    return *best;
+}
+
+Device::SendFuture DevicePool::send_sms_async(
+    vector<string> nums, string content,
+    std::shared_ptr<Device::SendTimes> times) {
+    // enqueue under the pool lock, so concurrent senders see the new load;
+    // the keepalive wakes the senders waiting for a healthy dongle
+    std::unique_lock<std::mutex> lock(_impl->_mutex);
+    _impl->_cv.wait(lock,
+                    [this] { return _impl->_stopped || _impl->any_healthy(); });
+    return _impl->select().device->send_sms_async(
+        std::move(nums), std::move(content), std::move(times));
+}
+
+SendSmsResult DevicePool::send_sms(vector<string> nums, string content) {
+    return send_sms_async(std::move(nums), std::move(content)).get();
+}
+
+void DevicePool::refresh_health() {
+    // members are only added before the pool is shared between threads
+    for (auto& m : _impl->_members) {
+        bool online{}, full{};
+        try {
+            online = m.device->heartbeat();
+            if (online) {
+                const auto status = m.device->snapshot()->system_status;
+                full = status->sms_state() == SystemStatus::SmsState::FULL;
+                m.signal_strength->set(status->signal_strength());
+            }
+        } catch (const std::exception&) {
+            online = false;
+        }
+        if (!online) m.heartbeat_failures->inc();
+
+        std::lock_guard<std::mutex> lock(_impl->_mutex);
+        if (online != m.online)
+            (online ? m.went_online : m.went_offline)->inc();
+        m.online = online;
+        m.full   = full;
+    }
+    _impl->_cv.notify_all();
+}
+
+void DevicePool::run_keepalive(NotAlive not_alive) {
+    std::unique_lock<std::mutex> lock(_impl->_mutex);
+    _impl->_is_running = !_impl->_stopped;
+    while (_impl->_is_running) {
+        if (_impl->_cv.wait_for(lock, _impl->_keepalive,
+                                [this] { return !_impl->_is_running; }))
+            break;
+        lock.unlock();
+        refresh_health();
+        const bool keep_on = in_rotation() > 0 || not_alive(*this);
+        lock.lock();
+        if (!keep_on) _impl->_is_running = false;
+    }
+}
+
+void DevicePool::stop_keepalive() {
+    {
+        std::lock_guard<std::mutex> lock(_impl->_mutex);
+        _impl->_is_running = false;
+        _impl->_stopped    = true;
+    }
+    _impl->_cv.notify_all();
+}
+
+void DevicePool::wait_alive() {
+    for (;;) {
+        refresh_health();
+        std::unique_lock<std::mutex> lock(_impl->_mutex);
+        if (_impl->any_healthy()) return;
+        if (_impl->_cv.wait_for(lock, _impl->_keepalive,
+                                [this] { return _impl->_stopped; }))
+            return;
+    }
+}
+
+bool DevicePool::is_running() {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    return _impl->_is_running;
+}
+
+}  // namespace messages
@@ -6,30 +6,87 @@ namespace staff {
 
 HttpClientConnector::HttpClientConnector(string hostname, int port,
                                          string base_path)
-    : _client{hostname.c_str(), port}, _timeout(seconds{15}), _path{base_path} {
+    : _client{hostname.c_str(), port},
+      _timeout(seconds{15}),
+      _host{hostname},
+      _path{base_path},
+      _session{},
+      _stats{},
+      _recorder{},
+      _replay{},
+      _latency{} {
     _hdrs = {{"Host", std::move(hostname)}, {"Connection", "keep-alive"}};
+    _client.set_default_headers(_hdrs);
+    _client.set_connection_timeout(_timeout);
+    session(true);
 }
 
 string HttpClientConnector::Send(const string& message) {
-    _client.set_default_headers(_hdrs);
-    _client.set_connection_timeout(_timeout);
-    auto res = _client.Post(_path, message, "application/json");
-    if (!res)
+    using std::chrono::steady_clock;
+
+    ++_stats.requests;
+    const auto start = steady_clock::now();
+    if (_replay) {
+        auto body = _replay->serve(_host, message);
+        latency(message).observe(
+            std::chrono::duration<double>(steady_clock::now() - start)
+                .count());
+        return body;
+    }
+    if (_session && _client.is_socket_open())
+        ++_stats.reused;
+    else
+        ++_stats.connects;
+
+    auto       res  = _client.Post(_path, message, "application/json");
+    const auto took = steady_clock::now() - start;
+    latency(message).observe(std::chrono::duration<double>(took).count());
+    if (_recorder)
+        _recorder->record(
+            start, std::chrono::duration_cast<std::chrono::microseconds>(took),
+            res ? res->status : 0, _host, message,
+            res ? res->body : httplib::to_string(res.error()));
+    if (!res) {
+        ++_stats.errors;
         throw std::runtime_error{fmt::format("connection error: {}",
                                              httplib::to_string(res.error()))};
-    if (res->status != 200)
+    }
+    if (res->status != 200) {
+        ++_stats.errors;
         throw jsonrpccxx::JsonRpcException(
             -32003, "http error: received status != 200");
+    }
 
     return res->body;
 }
 
+metrics::Histogram& HttpClientConnector::latency(const string& message) {
+    const auto method = method_of(message);
+    auto       it     = _latency.find(method);
+    if (it == _latency.end())
+        it = _latency
+                 .emplace(method, &metrics::registry().histogram(
+                                      "asmsd_rpc_duration_seconds",
+                                      "json rpc round trip to the dongle",
+                                      {{"method", method}}))
+                 .first;
+    return *it->second;
+}
+
 void HttpClientConnector::set_default_headers(HeadersInit headers) {
     for (auto& [k, v] : headers) _hdrs.insert({std::move(k), std::move(v)});
+    _client.set_default_headers(_hdrs);
 }
 
 void HttpClientConnector::timeout(const seconds& timeout) {
     _timeout = timeout;
+    _client.set_connection_timeout(_timeout);
+}
+
+void HttpClientConnector::session(bool enabled) {
+    _session = enabled;
+    _client.set_keep_alive(enabled);
+    _client.set_tcp_nodelay(enabled);
 }
 
-}  // namespace staff
\ No newline at end of file
+}  // namespace staff
@@ -0,0 +1,347 @@
+#include "inbox_mirror.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+#include "fmt/core.h"
+#include "nlohmann/json.hpp"
+#include "spool_file.hpp"
+
+namespace {
+using messages::SmsContact;
+using messages::SmsContent;
+using messages::string_view;
+using json = nlohmann::json;
+
+constexpr int VERSION = 1;
+
+json sms_json(const SmsContent& s) {
+    return {{"id", s.sms_id},           {"type", s.sms_type},
+            {"report", s.sms_report},   {"report_status", s.report_status},
+            {"report_id", s.report_id}, {"content", s.sms_content},
+            {"time", s.sms_time},       {"report_time", s.report_time},
+            {"tz", s.time_zone}};
+}
+
+void sms_from(const json& j, SmsContent& s) {
+    j.at("id").get_to(s.sms_id);
+    j.at("type").get_to(s.sms_type);
+    j.at("report").get_to(s.sms_report);
+    j.at("report_status").get_to(s.report_status);
+    j.at("report_id").get_to(s.report_id);
+    j.at("content").get_to(s.sms_content);
+    j.at("time").get_to(s.sms_time);
+    j.at("report_time").get_to(s.report_time);
+    j.at("tz").get_to(s.time_zone);
+}
+
+/// numbers are looked up with or without the leading +
+string_view phone_key(string_view phone) noexcept {
+    return phone.starts_with('+') ? phone.substr(1) : phone;
+}
+}  // namespace
+
+namespace messages {
+
+struct InboxMirror::_Impl {
+    struct Stored {
+        int        contact;
+        SmsContent sms;
+    };
+
+    fs::path _file;
+    int      _use_count;     // storage counters of the last sync
+    int      _unread_count;
+    bool     _synced;
+
+    std::map<int, SmsContact>                     _contacts;
+    std::map<int, Stored>                         _smses;  // by sms id
+    std::map<int, std::set<int>>                  _by_contact;
+    std::map<string, std::set<int>, std::less<>> _by_phone;  // contacts
+    std::multimap<time_t, int>                    _by_time;   // sms ids
+
+    explicit _Impl(fs::path file)
+        : _file(std::move(file)), _use_count{}, _unread_count{}, _synced{} {
+        load();
+    }
+
+    void add(int contact, const SmsContent& sms) {
+        if (_smses.contains(sms.sms_id)) remove(sms.sms_id);
+        _smses[sms.sms_id] = {contact, sms};
+        _by_contact[contact].insert(sms.sms_id);
+        _by_time.emplace(sms.sms_time, sms.sms_id);
+    }
+
+    void remove(int id) {
+        const auto it = _smses.find(id);
+        if (it == _smses.end()) return;
+        auto [beg, end] = _by_time.equal_range(it->second.sms.sms_time);
+        for (; beg != end; ++beg)
+            if (beg->second == id) {
+                _by_time.erase(beg);
+                break;
+            }
+        _by_contact[it->second.contact].erase(id);
+        _smses.erase(it);
+    }
+
+    void put_contact(const SmsContact& contact) {
+        if (const auto it = _contacts.find(contact.contact_id);
+            it != _contacts.end())
+            for (const auto& phone : it->second.phone_numbers)
+                _by_phone[string{phone_key(phone)}].erase(contact.contact_id);
+        for (const auto& phone : contact.phone_numbers)
+            _by_phone[string{phone_key(phone)}].insert(contact.contact_id);
+        _contacts[contact.contact_id] = contact;
+    }
+
+    size_t drop_contact(int id) {
+        const auto ids = _by_contact[id];
+        for (const auto sms_id : ids) remove(sms_id);
+        for (const auto& phone : _contacts[id].phone_numbers)
+            _by_phone[string{phone_key(phone)}].erase(id);
+        _by_contact.erase(id);
+        _contacts.erase(id);
+        return ids.size();
+    }
+
+    /// read on the dongle since, the contact has no unread SMS
+    void mark_read(int contact) {
+        for (const auto id : _by_contact[contact])
+            if (auto& sms = _smses[id].sms; sms.sms_type == SmsContent::UNREAD)
+                sms.sms_type = SmsContent::READ;
+    }
+
+    void fetch(Device& device, const SmsContact& contact, SyncStats& stats);
+
+    /// json lines: the counters, then a line per contact and per SMS
+    void load() {
+        std::ifstream in{_file};
+        string        line{};
+        for (size_t n{1}; std::getline(in, line); ++n) {
+            try {
+                const auto j = json::parse(line);
+                if (j.contains("mirror")) {
+                    if (j.at("mirror").get<int>() != VERSION) return;
+                    j.at("use_count").get_to(_use_count);
+                    j.at("unread_count").get_to(_unread_count);
+                    _synced = true;
+                } else if (j.contains("phones")) {
+                    SmsContact c{};
+                    sms_from(j.at("sms"), c);
+                    j.at("contact").get_to(c.contact_id);
+                    j.at("phones").get_to(c.phone_numbers);
+                    j.at("unread").get_to(c.unread_count);
+                    j.at("count").get_to(c.sms_count);
+                    put_contact(c);
+                } else {
+                    SmsContent s{};
+                    sms_from(j.at("sms"), s);
+                    add(j.at("contact").get<int>(), s);
+                }
+            } catch (const json::exception& e) {
+                throw std::runtime_error{fmt::format(
+                    "inbox mirror {} line {}: {}", _file.string(), n,
+                    e.what())};
+            }
+        }
+    }
+
+    void save() const {
+        string text = json{{"mirror", VERSION},
+                           {"use_count", _use_count},
+                           {"unread_count", _unread_count}}
+                          .dump() +
+                      '\n';
+        for (const auto& [id, c] : _contacts)
+            text += json{{"contact", id},
+                         {"phones", c.phone_numbers},
+                         {"unread", c.unread_count},
+                         {"count", c.sms_count},
+                         {"sms", sms_json(c)}}
+                        .dump() +
+                    '\n';
+        for (const auto& [id, s] : _smses)
+            text += json{{"contact", s.contact}, {"sms", sms_json(s.sms)}}
+                        .dump() +
+                    '\n';
+        const auto dir = _file.parent_path();
+        spool::write_spool_file(dir.empty() ? "." : dir,
+                                _file.filename().string(), text);
+    }
+};
+
+void InboxMirror::_Impl::fetch(Device& device, const SmsContact& contact,
+                               SyncStats& stats) {
+    const auto id    = contact.contact_id;
+    auto&      known = _by_contact[id];
+    const auto gained =
+        contact.sms_count - static_cast<int>(known.size());
+
+    // the SMSes it gained, when the rest is in the mirror already
+    if (!known.empty() && gained > 0) {
+        int found{};
+        for (const auto& list : device.all_sms_contents(id)) {
+            for (const auto& sms : list.contents) {
+                found += !_smses.contains(sms.sms_id);
+                add(id, sms);
+            }
+            if (found >= gained) break;
+        }
+        stats.added += static_cast<size_t>(found);
+        if (static_cast<int>(known.size()) == contact.sms_count) return;
+    }
+
+    // every page, what is not listed any more is dropped
+    std::set<int> listed{};
+    for (const auto& list : device.all_sms_contents(id))
+        for (const auto& sms : list.contents) {
+            stats.added += !_smses.contains(sms.sms_id);
+            listed.insert(sms.sms_id);
+            add(id, sms);
+        }
+    for (const auto sms_id : std::set<int>{known})
+        if (!listed.contains(sms_id)) {
+            remove(sms_id);
+            ++stats.removed;
+        }
+}
+
+InboxMirror::InboxMirror(fs::path file)
+    : _impl(std::make_unique<_Impl>(std::move(file))) {}
+
+InboxMirror::InboxMirror(InboxMirror&&) noexcept = default;
+
+InboxMirror::~InboxMirror() = default;
+
+InboxMirror::SyncStats InboxMirror::sync(Device& device) {
+    auto&     m = *_impl;
+    SyncStats stats{};
+
+    auto state = device.snapshot()->sms_storage_state;
+    if (!state) throw std::runtime_error{"device is not alive"};
+    if (m._synced && state->use_count() == m._use_count &&
+        state->unread_count() == m._unread_count) {
+        stats.unchanged = true;
+        return stats;
+    }
+
+    // the contacts come by their latest SMS, the newest first: once the
+    // counts add up, the ones not listed yet did not change
+    std::set<int> listed{};
+    bool          complete = true;
+    for (const auto& page : device.all_sms_contacts()) {
+        for (const auto& contact : page.contacts) {
+            listed.insert(contact.contact_id);
+            const auto it = m._contacts.find(contact.contact_id);
+            if (it == m._contacts.end() ||
+                it->second.sms_count != contact.sms_count ||
+                it->second.sms_id != contact.sms_id) {
+                m.fetch(device, contact, stats);
+                ++stats.contacts;
+            } else if (contact.unread_count == 0) {
+                m.mark_read(contact.contact_id);
+            }
+            m.put_contact(contact);
+        }
+        if (static_cast<int>(m._smses.size()) == state->use_count() &&
+            static_cast<int>(page.page) + 1 < page.total_pages) {
+            complete = false;
+            break;
+        }
+    }
+    if (complete) {
+        vector<int> gone{};
+        for (const auto& [id, c] : m._contacts)
+            if (!listed.contains(id)) gone.push_back(id);
+        for (const auto id : gone) stats.removed += m.drop_contact(id);
+    }
+
+    // listing the SMSes of a contact marks them read on the dongle
+    if (stats.contacts > 0) state = device.snapshot()->sms_storage_state;
+    m._use_count    = state->use_count();
+    m._unread_count = state->unread_count();
+    m._synced       = true;
+    m.save();
+    return stats;
+}
+
+SmsContactList InboxMirror::contacts() const {
+    SmsContactList res{};
+    res.page        = 0;
+    res.total_pages = 1;
+    for (const auto& [id, c] : _impl->_contacts) res.contacts.push_back(c);
+    std::sort(res.contacts.begin(), res.contacts.end(),
+              [](const SmsContact& a, const SmsContact& b) {
+                  return a.sms_id > b.sms_id;
+              });
+    return res;
+}
+
+SmsContentList InboxMirror::contents(int contact) const {
+    SmsContentList res{};
+    res.page        = 0;
+    res.total_pages = 1;
+    res.contact_id  = contact;
+    if (const auto it = _impl->_contacts.find(contact);
+        it != _impl->_contacts.end())
+        res.phone_numbers = it->second.phone_numbers;
+    if (const auto it = _impl->_by_contact.find(contact);
+        it != _impl->_by_contact.end())
+        for (const auto id : it->second)
+            res.contents.push_back(_impl->_smses.at(id).sms);
+    std::sort(res.contents.begin(), res.contents.end(),
+              [](const SmsContent& a, const SmsContent& b) {
+                  return std::tie(a.sms_time, a.sms_id) <
+                         std::tie(b.sms_time, b.sms_id);
+              });
+    return res;
+}
+
+vector<SmsContact> InboxMirror::find(string_view phone, string_view text,
+                                     std::time_t since) const {
+    const auto& m = *_impl;
+
+    vector<SmsContact> res{};
+    const auto         hit = [&](int id) {
+        const auto& [contact, sms] = m._smses.at(id);
+        if (sms.sms_time < since ||
+            (!text.empty() && sms.sms_content.find(text) == string::npos))
+            return;
+        SmsContact c{};
+        static_cast<SmsContent&>(c) = sms;
+        if (const auto it = m._contacts.find(contact);
+            it != m._contacts.end()) {
+            c.phone_numbers = it->second.phone_numbers;
+            c.sms_count     = it->second.sms_count;
+        }
+        c.contact_id = contact;
+        res.push_back(std::move(c));
+    };
+
+    if (!phone.empty()) {
+        const auto it = m._by_phone.find(phone_key(phone));
+        if (it == m._by_phone.end()) return res;
+        for (const auto contact : it->second)
+            if (const auto ids = m._by_contact.find(contact);
+                ids != m._by_contact.end())
+                for (const auto id : ids->second) hit(id);
+        std::sort(res.begin(), res.end(),
+                  [](const SmsContact& a, const SmsContact& b) {
+                      return std::tie(a.sms_time, a.sms_id) >
+                             std::tie(b.sms_time, b.sms_id);
+                  });
+    } else {
+        for (auto it = m._by_time.lower_bound(since); it != m._by_time.end();
+             ++it)
+            hit(it->second);
+        std::reverse(res.begin(), res.end());
+    }
+    return res;
+}
+}  // namespace messages
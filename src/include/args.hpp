@@ -48,6 +48,7 @@ class Args {
     const bool&           sms_contact_list() const& noexcept;
     const int&            sms_content_list() const& noexcept;
     const size_t&         page() const& noexcept;
+    const bool&           all_pages() const& noexcept;
     const vector<string>& send_sms() const& noexcept;
     vector<string>&&      send_sms() && noexcept;
     const string&         content() const& noexcept;
@@ -58,6 +59,34 @@ class Args {
     const seconds&        time_out() const& noexcept;
     const seconds&        keep_alive() const& noexcept;
     const minutes&        reprocess() const& noexcept;
+    const bool&           session() const& noexcept;
+    const vector<string>& devices() const& noexcept;
+    const fs::path&       journal() const& noexcept;
+    const seconds&        aging() const& noexcept;
+    const seconds&        coalesce() const& noexcept;
+    const size_t&         digest_segments() const& noexcept;
+    const seconds&        fanout() const& noexcept;
+    const size_t&         max_recipients() const& noexcept;
+    const size_t&         max_segments() const& noexcept;
+    const string&         over_length() const& noexcept;
+    const size_t&         max_file_size() const& noexcept;
+    const bool&           reactor() const& noexcept;
+    const fs::path&       checkpoint() const& noexcept;
+    const size_t&         intake_queue() const& noexcept;
+    const size_t&         parsers() const& noexcept;
+    const int&            metrics_port() const& noexcept;
+    const fs::path&       trace() const& noexcept;
+    const fs::path&       record() const& noexcept;
+    const fs::path&       replay() const& noexcept;
+    const double&         replay_speed() const& noexcept;
+    const fs::path&       receive() const& noexcept;
+    const fs::path&       receive_state() const& noexcept;
+    const seconds&        receive_interval() const& noexcept;
+    const fs::path&       mirror() const& noexcept;
+    const bool&           sync() const& noexcept;
+    const string&         search() const& noexcept;
+    const string&         phone() const& noexcept;
+    const minutes&        since() const& noexcept;
 
     Args();
     virtual ~Args();
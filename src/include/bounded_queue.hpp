@@ -0,0 +1,180 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace spool {
+
+/// bounded lock-free queue of many producers and consumers (a ring of
+/// sequenced slots), push() waits while it is full, pop() while empty
+template <typename T>
+class BoundedQueue {
+    struct Slot {
+        std::atomic<size_t> seq;
+        T                   value;
+    };
+
+    std::unique_ptr<Slot[]> _slots;
+    size_t                  _mask;
+
+    alignas(64) std::atomic<size_t> _head;  // next position to push
+    alignas(64) std::atomic<size_t> _tail;  // next position to pop
+
+    // wait/notify only when somebody waits, the fast path is syscall free
+    alignas(64) std::atomic<std::uint32_t> _pushes;
+    std::atomic<std::uint32_t> _pops;
+    std::atomic<std::uint32_t> _waiting_consumers;
+    std::atomic<std::uint32_t> _waiting_producers;
+    std::atomic<bool>          _closed;
+
+    std::atomic<size_t> _high_water;
+    std::atomic<size_t> _full_waits;
+
+   public:
+    struct Stats {
+        size_t pushed;
+        size_t popped;
+        size_t depth;
+        size_t high_water;
+        size_t full_waits;  // pushes waited for room: the backpressure
+    };
+
+    /// the capacity is rounded up to a power of two
+    explicit BoundedQueue(size_t capacity)
+        : _mask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1),
+          _head{},
+          _tail{},
+          _pushes{},
+          _pops{},
+          _waiting_consumers{},
+          _waiting_producers{},
+          _closed{},
+          _high_water{},
+          _full_waits{} {
+        _slots = std::make_unique<Slot[]>(_mask + 1);
+        for (size_t i{}; i <= _mask; ++i)
+            _slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&)            = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    virtual ~BoundedQueue() = default;
+
+    size_t capacity() const noexcept { return _mask + 1; }
+
+    /// false when it is full or closed, the value is left untouched then
+    bool try_push(T& value) {
+        if (_closed.load(std::memory_order_relaxed)) return false;
+        auto pos = _head.load(std::memory_order_relaxed);
+        for (;;) {
+            auto&      slot = _slots[pos & _mask];
+            const auto diff =
+                static_cast<std::intptr_t>(
+                    slot.seq.load(std::memory_order_acquire)) -
+                static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (_head.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+        auto& slot = _slots[pos & _mask];
+        slot.value = std::move(value);
+        slot.seq.store(pos + 1, std::memory_order_release);
+
+        const auto depth = pos + 1 - _tail.load(std::memory_order_relaxed);
+        if (depth > _high_water.load(std::memory_order_relaxed))
+            _high_water.store(depth, std::memory_order_relaxed);
+
+        _pushes.fetch_add(1);
+        if (_waiting_consumers.load() > 0) _pushes.notify_one();
+        return true;
+    }
+
+    std::optional<T> try_pop() {
+        auto pos = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            auto&      slot = _slots[pos & _mask];
+            const auto diff =
+                static_cast<std::intptr_t>(
+                    slot.seq.load(std::memory_order_acquire)) -
+                static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+        auto&            slot = _slots[pos & _mask];
+        std::optional<T> value{std::move(slot.value)};
+        slot.seq.store(pos + _mask + 1, std::memory_order_release);
+
+        _pops.fetch_add(1);
+        if (_waiting_producers.load() > 0) _pops.notify_one();
+        return value;
+    }
+
+    /// false when the queue is closed meanwhile
+    bool push(T value) {
+        bool waited{};
+        for (;;) {
+            const auto pops = _pops.load();
+            if (try_push(value)) return true;
+            if (_closed.load()) return false;
+            if (!waited) _full_waits.fetch_add(1, std::memory_order_relaxed);
+            waited = true;
+
+            _waiting_producers.fetch_add(1);
+            _pops.wait(pops);
+            _waiting_producers.fetch_sub(1);
+        }
+    }
+
+    /// empty once the queue is closed and drained
+    std::optional<T> pop() {
+        for (;;) {
+            const auto pushes = _pushes.load();
+            if (auto value = try_pop()) return value;
+            if (_closed.load()) return std::nullopt;
+
+            _waiting_consumers.fetch_add(1);
+            _pushes.wait(pushes);
+            _waiting_consumers.fetch_sub(1);
+        }
+    }
+
+    /// wakes up the waiting ones, the queued values can still be popped
+    void close() {
+        _closed.store(true);
+        _pushes.fetch_add(1);
+        _pops.fetch_add(1);
+        _pushes.notify_all();
+        _pops.notify_all();
+    }
+
+    Stats stats() const noexcept {
+        const auto pushed = _head.load(std::memory_order_relaxed);
+        const auto popped = _tail.load(std::memory_order_relaxed);
+        return {pushed, popped, pushed >= popped ? pushed - popped : 0,
+                _high_water.load(std::memory_order_relaxed),
+                _full_waits.load(std::memory_order_relaxed)};
+    }
+};
+}  // namespace spool
+
+#endif  // BOUNDED_QUEUE_HPP
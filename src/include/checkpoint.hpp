@@ -0,0 +1,56 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+namespace spool {
+namespace fs = std::filesystem;
+
+/// status change time (unix epoch nanoseconds) and inode of a file,
+/// unlike the modification time it is updated by moving a file in too
+struct FileStamp {
+    std::int64_t  ctime;
+    std::uint64_t inode;
+};
+
+std::optional<FileStamp> stamp_of(const fs::path& file) noexcept;
+
+/// the newest change time of the files taken from the watched directory,
+/// with the inodes of that time, kept over restarts
+class Checkpoint {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    explicit Checkpoint(fs::path file);
+
+    Checkpoint(Checkpoint&&) noexcept;
+
+    virtual ~Checkpoint();
+
+    /// nothing was taken yet
+    bool empty();
+
+    /// the file was taken before the checkpoint
+    bool covers(const FileStamp& stamp);
+
+    /// a queued file: the saved checkpoint stays before it until it is
+    /// done, so a crash before it is sent does not skip it; a failed one
+    /// is left taken for the next scan
+    void take(const fs::path& file, const FileStamp& stamp);
+
+    /// the taken file reached its final state; saved at most once a
+    /// second, save() writes it out at once
+    void advance(const fs::path& file);
+    void save();
+
+    /// not saved between these, while older files may still be untaken
+    void hold();
+    void release();
+};
+}  // namespace spool
+
+#endif  // CHECKPOINT_HPP
@@ -2,13 +2,18 @@
 #define DEVICE_H
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <future>
 #include <initializer_list>
+#include <iterator>
 #include <memory>
 #include <thread>
 #include <utility>
 #include <vector>
 
+#include "httpclientconnector.hpp"
 #include "messages.hpp"
 
 namespace messages {
@@ -20,10 +25,40 @@ class Device {
     std::unique_ptr<_Impl> _impl;
 
    public:
-    using NotAlive = std::function<bool(Device&)>;
+    using NotAlive        = std::function<bool(Device&)>;
+    using ConnectionStats = staff::HttpClientConnector::Stats;
+    using SendFuture      = std::future<SendSmsResult>;
     using HeadersInit =
         std::initializer_list<std::pair<std::string, std::string>>;
 
+    template <typename T>
+    using View = std::shared_ptr<const T>;
+
+    /// last known device state, immutable once it is published; every
+    /// refresh publishes a new version, views not refreshed are shared and
+    /// the views never fetched are null
+    struct State {
+        std::uint64_t                         version;
+        std::chrono::steady_clock::time_point updated;
+        View<SystemInfo>                      system_info;
+        View<SystemStatus>                    system_status;
+        View<ConnectionState>                 connection_state;
+        View<SmsStorageState>                 sms_storage_state;
+    };
+    using StatePtr = std::shared_ptr<const State>;
+
+    /// when a queued SMS was posted and first polled for its result,
+    /// set by the sender thread before the result is ready; on_posted is
+    /// called by it once the SendSMS rpc returned, it must not throw
+    struct SendTimes {
+        std::chrono::steady_clock::time_point posted;
+        std::chrono::steady_clock::time_point polled;
+        std::function<void()>                 on_posted;
+    };
+
+    template <typename List>
+    class Pages;
+
     Device(string hostname, int port, string base_path, seconds keepalive,
            seconds timeout, char ver);
 
@@ -31,19 +66,99 @@ class Device {
 
     virtual ~Device();
 
-    const SystemInfo&      system_info();
-    const SystemStatus&    system_status();
-    const ConnectionState& connection_state();
-    const SmsStorageState& sms_storage_state();
-    const SmsContactList&  sms_contacts(size_t page);
-    const SmsContentList&  sms_contents(int contact, size_t page);
-    void                   delete_sms(int contact, int sms = -1);
-    SendSmsResult          send_sms(vector<string> nums, string content);
-    void                   run_keepalive(NotAlive not_alive);
-    void                   stop_keepalive();
-    void                   wait_alive();
-    void                   set_default_headers(HeadersInit hdrs);
-    bool                   is_running();
+    /// the views of the published state, they do not wait for the dongle;
+    /// snapshot() fetches them in one round trip and publishes them
+    View<SystemInfo>      system_info() const;
+    View<SystemStatus>    system_status() const;
+    View<ConnectionState> connection_state() const;
+    View<SmsStorageState> sms_storage_state() const;
+    StatePtr              snapshot();
+    StatePtr              state() const;
+    SmsContactList        sms_contacts(size_t page);
+    SmsContentList        sms_contents(int contact, size_t page);
+    Pages<SmsContactList> all_sms_contacts(size_t first = 1);
+    Pages<SmsContentList> all_sms_contents(int contact, size_t first = 1);
+    void                  delete_sms(int contact, int sms = -1);
+    SendSmsResult         send_sms(vector<string> nums, string content);
+    SendFuture            send_sms_async(vector<string> nums, string content,
+                                         std::shared_ptr<SendTimes> times = {});
+    size_t                pending_sms();
+    void                  run_keepalive(NotAlive not_alive);
+    void                  stop_keepalive();
+    void                  wait_alive();
+    bool                  heartbeat();
+    void                  set_default_headers(HeadersInit hdrs);
+    bool                  is_running();
+    void                  session(bool enabled);
+    ConnectionStats       connection_stats();
+    void                  record(staff::Recorder* recorder);
+    void                  replay(staff::Replay* replay);
+};
+
+/// the pages of a list from a first one to the last by the TotalPageCount
+/// of the pages; the next page is fetched in the background while the
+/// current one is consumed, so two pages are held at most. A page throws
+/// what its fetch did. The device must outlive its pages.
+template <typename List>
+class Device::Pages {
+   public:
+    using Fetch = std::function<List(size_t page)>;
+
+    class iterator {
+        Pages* _pages;
+
+       public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = List;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const List*;
+        using reference         = const List&;
+
+        explicit iterator(Pages* pages = nullptr) : _pages(pages) {}
+
+        reference operator*() const { return _pages->_current; }
+        pointer   operator->() const { return &_pages->_current; }
+
+        iterator& operator++() {
+            if (!_pages->advance()) _pages = nullptr;
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const noexcept {
+            return _pages == other._pages;
+        }
+    };
+
+    Pages(Fetch fetch, size_t first)
+        : _fetch(std::move(fetch)), _page(first > 0 ? first : 1) {
+        prefetch(_page);
+    }
+
+    Pages(Pages&&) noexcept = default;
+
+    virtual ~Pages() = default;
+
+    /// the first page is waited for here
+    iterator begin() { return iterator{advance() ? this : nullptr}; }
+    iterator end() noexcept { return iterator{}; }
+
+   private:
+    Fetch             _fetch;
+    size_t            _page;  // 1 based, of the page fetched next
+    List              _current;
+    std::future<List> _next;
+
+    void prefetch(size_t page) {
+        _next = std::async(std::launch::async, _fetch, page);
+    }
+
+    bool advance() {
+        if (!_next.valid()) return false;
+        _current = _next.get();
+        // an empty list answers with no pages, it is still shown once
+        if (static_cast<int>(_page) < _current.total_pages) prefetch(++_page);
+        return true;
+    }
 };
 }  // namespace messages
 
@@ -0,0 +1,56 @@
+#ifndef DEVICE_POOL_H
+#define DEVICE_POOL_H
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "device.hpp"
+
+namespace messages {
+using std::vector;
+using std::chrono::seconds;
+
+/// spreads outgoing SMSes over several dongles, a dongle is taken out of
+/// rotation while it does not answer heart beats or its SMS storage is full;
+/// sending waits while no dongle is in rotation
+class DevicePool {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    using NotAlive = std::function<bool(DevicePool&)>;
+
+    /// the pool was stopped while no dongle was in rotation, nothing is sent
+    struct NotInRotation : std::runtime_error {
+        NotInRotation() : std::runtime_error("no dongle is in rotation") {}
+    };
+
+    explicit DevicePool(seconds keepalive);
+
+    DevicePool(DevicePool&& other) noexcept;
+
+    virtual ~DevicePool();
+
+    Device&            add(std::unique_ptr<Device> device);
+    Device&            primary();
+    Device&            at(size_t i);
+    size_t             size() const noexcept;
+    size_t             in_rotation();
+    SendSmsResult      send_sms(vector<string> nums, string content);
+    Device::SendFuture send_sms_async(
+        vector<string> nums, string content,
+        std::shared_ptr<Device::SendTimes> times = {});
+    void               refresh_health();
+    void               run_keepalive(NotAlive not_alive);
+    void               stop_keepalive();
+    /// probes the dongles itself, the senders wait for the keepalive;
+    /// returns once stop_keepalive() is called as well
+    void               wait_alive();
+    bool               is_running();
+};
+}  // namespace messages
+
+#endif
@@ -6,6 +6,9 @@
 #endif
 
 #include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
 #include <stdexcept>
 #include <string>
 
@@ -13,20 +16,43 @@
 #include "httplib.h"
 #include "jsonrpccxx/common.hpp"
 #include "jsonrpccxx/iclientconnector.hpp"
+#include "metrics.hpp"
+#include "rpc_recording.hpp"
 
 namespace staff {
 using httplib::Headers;
 using jsonrpccxx::IClientConnector;
 using jsonrpccxx::JsonRpcException;
+using std::size_t;
 using std::string;
 using std::string_view;
 using std::chrono::seconds;
 
 class HttpClientConnector : public IClientConnector {
+   public:
+    /// per session counters, reused + connects == requests
+    struct Stats {
+        size_t requests;  // every POST sent through the connector
+        size_t reused;    // went out on an already open socket
+        size_t connects;  // had to open (or reopen) the socket
+        size_t errors;    // connection or http status failures
+    };
+
+   private:
     httplib::Client _client;
     seconds         _timeout;
+    string          _host;
     string          _path;
     Headers         _hdrs;
+    bool            _session;
+    Stats           _stats;
+    Recorder*       _recorder;
+    Replay*         _replay;
+
+    // latency by rpc method, looked up in the registry once per method
+    std::map<string, metrics::Histogram*, std::less<>> _latency;
+
+    metrics::Histogram& latency(const string& message);
 
    public:
     using HeadersInit =
@@ -41,7 +67,21 @@ class HttpClientConnector : public IClientConnector {
     void timeout(const seconds& timeout);
 
     inline const seconds& timeout() { return _timeout; }
+
+    /// keep one socket open (with TCP_NODELAY) between requests,
+    /// it is reopened only after an error or when the peer closed it
+    void session(bool enabled);
+
+    inline bool session() const noexcept { return _session; }
+
+    inline const Stats& stats() const noexcept { return _stats; }
+
+    /// appends every round trip to the recorder, null stops recording
+    inline void record(Recorder* recorder) noexcept { _recorder = recorder; }
+
+    /// serves the requests from the replay instead of the dongle
+    inline void replay(Replay* replay) noexcept { _replay = replay; }
 };
 }  // end namespace staff
 
-#endif
\ No newline at end of file
+#endif
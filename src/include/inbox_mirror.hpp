@@ -0,0 +1,56 @@
+#ifndef INBOX_MIRROR_HPP
+#define INBOX_MIRROR_HPP
+
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "device.hpp"
+
+namespace messages {
+namespace fs = std::filesystem;
+
+/// on disk copy of the SMS storage of a dongle: the contacts and their
+/// SMSes by contact and SMS id, indexed by phone number and time, so the
+/// lists and searches are answered without the device
+class InboxMirror {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    struct SyncStats {
+        bool   unchanged;  // by the storage counters, nothing was listed
+        size_t contacts;   // of which the SMSes were fetched
+        size_t added;
+        size_t removed;
+    };
+
+    /// loaded when the file exists
+    explicit InboxMirror(fs::path file);
+
+    InboxMirror(InboxMirror&&) noexcept;
+
+    virtual ~InboxMirror();
+
+    /// brings the mirror up to date and saves it: nothing is listed while
+    /// the storage counters are unchanged, the contacts are listed from the
+    /// newest until the counts add up, and a contact is fetched only when
+    /// its TSMSCount or latest SMS changed, up to the SMSes it gained
+    SyncStats sync(Device& device);
+
+    /// contacts with their latest SMS, the newest first, on one page
+    SmsContactList contacts() const;
+
+    /// the SMSes of a contact in time order, on one page
+    SmsContentList contents(int contact) const;
+
+    /// SMSes of a phone number (all when empty) since a time, containing
+    /// the text, the newest first
+    vector<SmsContact> find(string_view phone, string_view text,
+                            std::time_t since) const;
+};
+}  // namespace messages
+
+#endif  // INBOX_MIRROR_HPP
@@ -0,0 +1,62 @@
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace spool {
+namespace fs = std::filesystem;
+using namespace std::string_view_literals;
+
+using std::string_view;
+using std::vector;
+
+/// append only log of the spool files state transitions,
+/// every record is durable (fdatasync-ed) when record() returns
+class Journal {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    static constexpr auto ACCEPTED_SV  = "accepted"sv;
+    static constexpr auto SUBMITTED_SV = "submitted"sv;
+    static constexpr auto SUCCEEDED_SV = "succeeded"sv;
+    static constexpr auto FAILED_SV    = "failed"sv;
+
+    enum class Status : std::uint8_t { ACCEPTED, SUBMITTED, SUCCEEDED, FAILED };
+
+    struct Entry {
+        Status   status;
+        fs::path path;
+    };
+
+    static const string_view& as_strv(Status) noexcept;
+
+    static inline bool is_final(Status st) noexcept {
+        return st == Status::SUCCEEDED || st == Status::FAILED;
+    }
+
+    /// replays then compacts the journal file, creates it when missing
+    explicit Journal(fs::path file);
+
+    Journal(Journal&&) noexcept;
+
+    virtual ~Journal();
+
+    /// files which were accepted but did not reach a final state before
+    /// the last stop, in the order they were accepted
+    const vector<Entry>& pending() const& noexcept;
+
+    /// last state of the file as it was replayed at startup
+    std::optional<Status> replayed(const fs::path& file) const;
+
+    /// appends a transition, concurrent records share one fdatasync
+    void record(const fs::path& file, Status status);
+};
+}  // namespace spool
+
+#endif  // JOURNAL_HPP
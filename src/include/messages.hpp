@@ -230,11 +230,16 @@ struct SmsContent {
     inline const string_view& sms_type_sv() const noexcept {
         return as_strv(sms_type);
     }
-    inline const std::tm& sms_time_ltm() const noexcept {
-        return *std::localtime(&sms_time);
+    /// the times in the local time zone, safe to call from any thread
+    inline std::tm sms_time_ltm() const noexcept {
+        std::tm res{};
+        ::localtime_r(&sms_time, &res);
+        return res;
     }
-    inline const std::tm& report_time_ltm() const noexcept {
-        return *std::localtime(&report_time);
+    inline std::tm report_time_ltm() const noexcept {
+        std::tm res{};
+        ::localtime_r(&report_time, &res);
+        return res;
     }
 };
 
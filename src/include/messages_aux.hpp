@@ -1,6 +1,10 @@
 #ifndef MESSAGES_AUX_HPP
 #define MESSAGES_AUX_HPP
 #include <concepts>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <variant>
 
 #include "messages.hpp"
 #include "nlohmann/json.hpp"
@@ -15,6 +19,25 @@ struct aux {
     static SmsStorageState& from_json(const json&, SmsStorageState&);
     static ConnectionState& emplace_json(ConnectionState&, json&&);
 
+    /// the error object of a json rpc response
+    struct rpc_error : std::runtime_error {
+        int code;
+
+        rpc_error(int c, const std::string& message)
+            : std::runtime_error(message), code(c) {}
+    };
+
+    using view_ptr = std::variant<SystemInfo*, SystemStatus*, SmsStorageState*,
+                                  ConnectionState*>;
+
+    /// streams the results of a json rpc response body, or of a batch of
+    /// them, into the views in order without building a json tree; false
+    /// when the responses do not answer the ids from first_id on, throws
+    /// rpc_error for an error response and invalid_argument for a broken one
+    /// or a result without a member the view requires
+    static bool decode(std::string_view body, std::uint32_t first_id,
+                       std::initializer_list<view_ptr> views);
+
     static named_parameter as_param(const Page&);
     static named_parameter as_param(const GetSmsContentList&);
     static named_parameter as_param(SendSms&&);
@@ -0,0 +1,117 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace metrics {
+using std::string;
+using std::string_view;
+
+class Counter {
+    std::atomic<std::uint64_t> _value{};
+
+   public:
+    inline void inc(std::uint64_t n = 1) noexcept {
+        _value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    inline std::uint64_t value() const noexcept {
+        return _value.load(std::memory_order_relaxed);
+    }
+};
+
+class Gauge {
+    std::atomic<double> _value{};
+
+   public:
+    inline void set(double value) noexcept {
+        _value.store(value, std::memory_order_relaxed);
+    }
+
+    inline double value() const noexcept {
+        return _value.load(std::memory_order_relaxed);
+    }
+};
+
+/// latency histogram in seconds: every thread counts into its own shard
+/// of buckets, the shards are only summed up when collected
+class Histogram {
+   public:
+    static constexpr std::array<double, 12> BOUNDS{
+        0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+        0.1,   0.25,   0.5,   1.0,  2.5,   5.0};
+    static constexpr size_t SHARDS = 16;
+
+    struct Snapshot {
+        std::array<std::uint64_t, BOUNDS.size() + 1> buckets;  // last: +Inf
+        std::uint64_t                                count;
+        double                                       sum;
+    };
+
+    void observe(double seconds) noexcept;
+
+    Snapshot collect() const noexcept;
+
+   private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<std::uint64_t>, BOUNDS.size() + 1> buckets;
+        std::atomic<std::uint64_t>                                sum_ns;
+    };
+
+    std::array<Shard, SHARDS> _shards{};
+};
+
+/// names the metrics and renders them in the prometheus text format,
+/// the same name and labels always give back the same metric
+class Registry {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    enum class Type : std::uint8_t { COUNTER, GAUGE, HISTOGRAM };
+
+    using Labels = std::initializer_list<std::pair<string_view, string_view>>;
+    using Sample = std::function<double()>;
+
+    Registry();
+
+    virtual ~Registry();
+
+    Counter&   counter(string_view name, string_view help, Labels labels = {});
+    Gauge&     gauge(string_view name, string_view help, Labels labels = {});
+    Histogram& histogram(string_view name, string_view help,
+                         Labels labels = {});
+
+    /// a value taken at every render, the sample has to outlive the
+    /// rendering of the registry
+    void sample(Type type, string_view name, string_view help, Labels labels,
+                Sample sample);
+
+    string render();
+};
+
+/// the registry of the process
+Registry& registry();
+
+/// serves GET /metrics of the registry on its own thread
+class Server {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    /// throws when it is not able to listen on the address
+    Server(Registry& registry, const string& host, int port);
+
+    virtual ~Server();
+};
+}  // namespace metrics
+
+#endif  // METRICS_HPP
@@ -0,0 +1,85 @@
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+namespace spool {
+namespace fs = std::filesystem;
+
+using std::vector;
+using std::chrono::milliseconds;
+
+/// single threaded epoll loop: file descriptors, timers and signals
+/// are dispatched to their handlers on the thread calling run()
+class Reactor {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    using Handler       = std::function<void(std::uint32_t events)>;
+    using Tick          = std::function<void()>;
+    using SignalHandler = std::function<void(int signo)>;
+
+    /// blocks the signals in the calling thread and the threads it starts
+    /// later, so they are only delivered through on_signals()
+    static void block(std::initializer_list<int> signals);
+
+    Reactor();
+
+    Reactor(Reactor&&) noexcept;
+
+    virtual ~Reactor();
+
+    /// the file descriptor stays owned by the caller
+    void watch(int fd, std::uint32_t events, Handler handler);
+    void unwatch(int fd);
+
+    /// calls the tick every interval, the first time after one interval
+    void every(milliseconds interval, Tick tick);
+
+    /// the signals have to be blocked with block() before
+    void on_signals(std::initializer_list<int> signals, SignalHandler handler);
+
+    /// may be called from any thread, the task runs on the loop; the tasks
+    /// posted after stop() are dropped
+    void post(Tick task);
+
+    /// dispatches until stop()
+    void run();
+
+    /// may be called from any thread
+    void stop();
+};
+
+/// recursive inotify watch of a directory for completed files
+class DirectoryWatch {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    explicit DirectoryWatch(const fs::path& dir);
+
+    DirectoryWatch(DirectoryWatch&&) noexcept;
+
+    virtual ~DirectoryWatch();
+
+    /// non blocking, to be polled for reading
+    int fd() const noexcept;
+
+    /// files closed after writing or moved in since the last call, with
+    /// the files of the directories created or moved in
+    vector<fs::path> read();
+
+    /// drops the watches, files created meanwhile are not reported
+    void pause();
+    void resume();
+};
+}  // namespace spool
+
+#endif  // REACTOR_HPP
@@ -0,0 +1,40 @@
+#ifndef RECEIVER_HPP
+#define RECEIVER_HPP
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "device.hpp"
+
+namespace spool {
+namespace fs = std::filesystem;
+
+using std::string;
+using std::chrono::seconds;
+
+/// writes the SMSes received by the dongles into an incoming directory as
+/// smsd files: while nothing is new a poll costs the batched status round
+/// trip at most, the content lists are fetched only for the contacts with
+/// unread SMSes, and an SMS is written once by its id
+class Receiver {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    /// the ids of the written SMSes are kept in the state file, if there
+    /// is one, so a restart does not write them again; a published device
+    /// state younger than fresh is taken without a round trip
+    Receiver(fs::path incoming, fs::path state, seconds fresh);
+
+    Receiver(Receiver&&) noexcept;
+
+    virtual ~Receiver();
+
+    /// writes the new SMSes of the device, returns how many
+    size_t poll(messages::Device& device, const string& modem);
+};
+}  // namespace spool
+
+#endif  // RECEIVER_HPP
@@ -0,0 +1,65 @@
+#ifndef RPC_RECORDING_HPP
+#define RPC_RECORDING_HPP
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace staff {
+namespace fs = std::filesystem;
+
+using std::string;
+using std::string_view;
+using std::chrono::microseconds;
+
+/// the method of a json rpc request without parsing it, "batch" for more
+string_view method_of(string_view message) noexcept;
+
+/// appends the exchanges of every connector recording into it to a log:
+/// a header line of "at took status host request-size response-size" in
+/// microseconds and bytes, then the request and the response as they are
+class Recorder {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    /// truncates the log file
+    explicit Recorder(const fs::path& file);
+
+    Recorder(Recorder&&) noexcept;
+
+    virtual ~Recorder();
+
+    /// the time of the exchange is taken relative to the recording
+    void record(std::chrono::steady_clock::time_point start,
+                microseconds took, int status, string_view host,
+                string_view request, string_view response);
+};
+
+/// serves the recorded responses back: a request gets the next unused
+/// exchange of the same host and method, with the ids of the request, after
+/// the recorded round trip divided by the speed (zero does not wait)
+class Replay {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    Replay(const fs::path& file, double speed);
+
+    Replay(Replay&&) noexcept;
+
+    virtual ~Replay();
+
+    /// throws as the http connector would: connection errors as
+    /// runtime_error, http errors as JsonRpcException
+    string serve(string_view host, const string& request);
+
+    /// exchanges not served yet, reported on exit
+    size_t left();
+};
+}  // namespace staff
+
+#endif  // RPC_RECORDING_HPP
@@ -0,0 +1,80 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace spool {
+namespace fs = std::filesystem;
+using namespace std::string_view_literals;
+
+using std::string;
+using std::string_view;
+using std::vector;
+using std::chrono::seconds;
+using std::chrono::steady_clock;
+
+enum class Priority : std::uint8_t { CRITICAL, HIGH, NORMAL, LOW };
+
+static constexpr auto CRITICAL_SV = "critical"sv;
+static constexpr auto HIGH_SV     = "high"sv;
+static constexpr auto NORMAL_SV   = "normal"sv;
+static constexpr auto LOW_SV      = "low"sv;
+
+const string_view&      as_strv(Priority) noexcept;
+std::optional<Priority> priority_from(string_view name) noexcept;
+
+/// one spool file read in, waiting to be sent, or a digest of more files
+/// sent to the same recipients; a digest keeps the time points of its
+/// first file
+struct Message {
+    vector<fs::path>         files;
+    vector<string>           phone_numbers;
+    string                   content;
+    Priority                 priority;
+    steady_clock::time_point queued;
+    steady_clock::time_point seen;    // reported by the watch or the scan
+    steady_clock::time_point parsed;
+};
+
+/// messages to the same recipients arriving within the window after the
+/// first one are merged into one digest, critical ones are never held
+struct Coalescing {
+    seconds window;    // zero turns coalescing off
+    size_t  segments;  // the digest is cut to fit into this many SMSes
+};
+
+/// outbound queue draining higher priority classes first, a waiting
+/// message climbs one class for every aging period up to HIGH, so lower
+/// classes are delayed but never starved, and a CRITICAL message still
+/// takes the next send slot; the same text to other recipients
+/// arriving within the fan out window is merged into one message
+class Scheduler {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    explicit Scheduler(seconds aging, Coalescing coalescing = {},
+                       seconds fanout = {});
+
+    Scheduler(Scheduler&&) noexcept;
+
+    virtual ~Scheduler();
+
+    void push(Message msg);
+
+    /// blocks until a message is ready, empty after stop()
+    std::optional<Message> pop();
+
+    void   stop();
+    size_t size();
+};
+}  // namespace spool
+
+#endif  // SCHEDULER_HPP
@@ -0,0 +1,62 @@
+#ifndef SMS_TEXT_HPP
+#define SMS_TEXT_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace messages {
+using namespace std::string_view_literals;
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+enum class Alphabet : std::uint8_t { GSM7, UCS2 };
+
+static constexpr auto GSM7_SV = "GSM-7"sv;
+static constexpr auto UCS2_SV = "UCS-2"sv;
+
+const string_view& as_strv(Alphabet) noexcept;
+
+/// how an utf-8 text goes over the air
+struct TextInfo {
+    Alphabet alphabet;
+    size_t   units;  // septets for gsm-7, utf-16 code units for ucs-2
+    size_t   segments;
+};
+
+/// what to do with a text longer than the allowed segments
+enum class OverLength : std::uint8_t { SEND, TRUNCATE, SPLIT, REJECT };
+
+static constexpr auto SEND_SV     = "send"sv;
+static constexpr auto TRUNCATE_SV = "truncate"sv;
+static constexpr auto SPLIT_SV    = "split"sv;
+static constexpr auto REJECT_SV   = "reject"sv;
+
+const string_view&        as_strv(OverLength) noexcept;
+std::optional<OverLength> over_length_from(string_view name) noexcept;
+
+bool valid_utf8(string_view text) noexcept;
+
+/// replaces every byte of an invalid utf-8 sequence with '?'
+string sanitize_utf8(string_view text);
+
+/// the text has to be valid utf-8
+TextInfo inspect(string_view text) noexcept;
+
+/// cuts the text to fit into segments, marked with "..." at the end
+string truncate(string_view text, size_t segments);
+
+/// breaks the text into parts fitting into segments each,
+/// at a white space when there is one near the end of the part
+vector<string> split(string_view text, size_t segments);
+
+/// applies the policy to a text longer than max segments (0: unlimited),
+/// returns the SMS texts to send, none when it is rejected
+vector<string> fit(string text, size_t max_segments, OverLength policy);
+}  // namespace messages
+
+#endif  // SMS_TEXT_HPP
@@ -0,0 +1,64 @@
+#ifndef SPOOL_FILE_HPP
+#define SPOOL_FILE_HPP
+
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace spool {
+namespace fs = std::filesystem;
+using namespace std::string_view_literals;
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+/// text encoding of the body, by the smsd Alphabet: header
+enum class Charset : std::uint8_t { UTF8, ISO, UCS2 };
+
+static constexpr auto UTF8_SV = "UTF-8"sv;
+static constexpr auto ISO_SV  = "ISO-8859-15"sv;
+static constexpr auto UCS2_SV = "UCS-2"sv;
+
+const string_view& as_strv(Charset) noexcept;
+
+/// the smsd headers and the body of a spool file, viewing into its text
+struct SpoolFile {
+    vector<string_view> to;
+    string_view         priority;
+    bool                flash;
+    Charset             charset;
+    string_view         body;
+};
+
+/// reads the whole file with one read, throws when it is over max size
+string read_spool_file(const fs::path& file, size_t max_size);
+
+/// parses the headers up to the first empty line without copying them,
+/// throws std::invalid_argument when the file can not be sent as an SMS
+SpoolFile parse_spool_file(string_view text);
+
+/// moves the body out of the text of the parsed file, as utf-8
+string take_body(string&& text, const SpoolFile& file);
+
+/// a received SMS, written as an smsd incoming file
+struct IncomingFile {
+    string_view from;  // the phone number, smsd drops the leading +
+    std::time_t sent;
+    std::time_t received;
+    string_view modem;
+    string_view body;  // utf-8
+};
+
+string format_incoming_file(const IncomingFile& file);
+
+/// written into a hidden file of the directory, synced, then renamed to
+/// its name, so readers of the directory never see a partial file
+void write_spool_file(const fs::path& dir, const string& name,
+                      string_view text);
+}  // namespace spool
+
+#endif  // SPOOL_FILE_HPP
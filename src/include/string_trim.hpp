@@ -17,7 +17,7 @@ static inline std::string_view ltrim_sv(const std::string_view& sv) {
     const auto lst = std::find_if(sv.begin(), sv.end(), [](unsigned char ch) {
         return !std::isspace(ch);
     });
-    return sv.substr(0, lst - sv.begin());
+    return sv.substr(lst - sv.begin());
 }
 
 // trim from end (in place)
@@ -32,7 +32,7 @@ static inline std::string_view rtrim_sv(const std::string_view& sv) {
     const auto fst = std::find_if(sv.rbegin(), sv.rend(), [](unsigned char ch) {
         return !std::isspace(ch);
     });
-    return sv.substr(sv.rend() - fst, fst - sv.rbegin());
+    return sv.substr(0, sv.rend() - fst);
 }
 
 // trim from both ends (in place)
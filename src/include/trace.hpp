@@ -0,0 +1,81 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace spool {
+namespace fs = std::filesystem;
+using namespace std::string_view_literals;
+
+using std::string_view;
+using std::vector;
+using std::chrono::steady_clock;
+
+/// lifecycle of the messages from the watch event to the moved file,
+/// one json line per message is appended to the trace file
+class Trace {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    static constexpr auto SEEN_SV   = "seen"sv;
+    static constexpr auto PARSED_SV = "parsed"sv;
+    static constexpr auto QUEUED_SV = "queued"sv;
+    static constexpr auto POSTED_SV = "posted"sv;
+    static constexpr auto POLLED_SV = "polled"sv;
+    static constexpr auto SENT_SV   = "sent"sv;
+    static constexpr auto MOVED_SV  = "moved"sv;
+
+    /// in the order they are reached: the file event, parsed, pushed to
+    /// the scheduler, SendSMS posted, first GetSendSMSResult, SUCCESS,
+    /// renamed to the move to directory
+    enum class Stage : std::uint8_t {
+        SEEN,
+        PARSED,
+        QUEUED,
+        POSTED,
+        POLLED,
+        SENT,
+        MOVED
+    };
+    static constexpr size_t STAGES = 7;
+
+    /// time points of the stages of one message, unset ones are zero
+    using Stamps = std::array<steady_clock::time_point, STAGES>;
+
+    struct Summary {
+        Stage                     stage;
+        size_t                    count;
+        std::chrono::microseconds p50;
+        std::chrono::microseconds p99;
+    };
+
+    static const string_view& as_strv(Stage) noexcept;
+
+    /// appends to the trace file, creates it when missing
+    explicit Trace(const fs::path& file);
+
+    Trace(Trace&&) noexcept;
+
+    virtual ~Trace();
+
+    /// writes the record of a message reached a final state
+    void record(const vector<fs::path>& files, const Stamps& stamps,
+                bool succeeded);
+
+    /// percentiles of the time spent before each stage since the
+    /// previous one reached, over the recent messages
+    vector<Summary> summary();
+
+    /// writes the summary into the trace file as its own record
+    void write_summary();
+};
+}  // namespace spool
+
+#endif  // TRACE_HPP
@@ -0,0 +1,234 @@
+#include "journal.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "fmt/core.h"
+
+namespace {
+using namespace std::string_view_literals;
+
+using std::string;
+using Status = spool::Journal::Status;
+
+constexpr auto CODES = "ASOF"sv;  // one letter per status, in enum order
+
+std::system_error errno_error(const char* what) {
+    return std::system_error{errno, std::generic_category(), what};
+}
+
+void write_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const auto n = ::write(fd, data.data(), data.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw errno_error("journal write");
+        }
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+}
+
+void sync_fd(int fd) {
+    if (::fdatasync(fd) != 0) throw errno_error("journal sync");
+}
+
+// the watcher and the directory scan may name the same file differently
+spool::fs::path key(const spool::fs::path& file) {
+    return spool::fs::absolute(file).lexically_normal();
+}
+
+void sync_dir(const spool::fs::path& dir) {
+    const auto fd = ::open(dir.empty() ? "." : dir.c_str(),
+                           O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) throw errno_error("journal directory open");
+    ::fsync(fd);
+    ::close(fd);
+}
+}  // namespace
+
+namespace spool {
+
+struct Journal::_Impl {
+    fs::path                   _file;
+    int                        _fd;
+    std::map<fs::path, Status> _replayed;
+    vector<Entry>              _pending;
+    std::mutex                 _mutex;
+    std::condition_variable    _commit_cv;
+    std::condition_variable    _durable_cv;
+    string                     _buffer;
+    std::uint64_t              _appended;
+    std::uint64_t              _durable;
+    std::exception_ptr         _error;
+    bool                       _stopping;
+    std::thread                _committer;
+
+    explicit _Impl(fs::path file)
+        : _file(std::move(file)),
+          _fd(-1),
+          _appended{},
+          _durable{},
+          _stopping{} {}
+
+    void load();
+    void compact();
+    void run_committer();
+};
+
+void Journal::_Impl::load() {
+    std::ifstream in{_file, std::ios::binary};
+    if (!in) return;
+
+    vector<fs::path> order{};
+    string           line{};
+    while (std::getline(in, line)) {
+        // a line without its terminating LF is a torn append, drop it
+        if (in.eof()) break;
+        if (line.size() < 3 || line[1] != ' ') continue;
+        const auto code = CODES.find(line[0]);
+        if (code == string_view::npos) continue;
+
+        auto path = fs::path{line.substr(2)};
+        const auto [it, added] =
+            _replayed.insert_or_assign(path, static_cast<Status>(code));
+        if (added) order.push_back(std::move(path));
+    }
+    for (auto& path : order) {
+        const auto st = _replayed.at(path);
+        if (!is_final(st)) _pending.push_back({st, std::move(path)});
+    }
+}
+
+// rewrites the journal with the last state of the files still on disk
+void Journal::_Impl::compact() {
+    auto tmp = _file;
+    tmp += ".tmp";
+
+    const auto fd =
+        ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd < 0) throw errno_error("journal compact open");
+    try {
+        string data{};
+        for (const auto& [path, st] : _replayed) {
+            std::error_code ec{};
+            if (fs::exists(path, ec))
+                data += fmt::format("{} {}\n", CODES[static_cast<size_t>(st)],
+                                    path.string());
+        }
+        write_all(fd, data);
+        sync_fd(fd);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+
+    fs::rename(tmp, _file);
+    sync_dir(_file.parent_path());
+}
+
+void Journal::_Impl::run_committer() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _commit_cv.wait(lock, [this] { return _stopping || !_buffer.empty(); });
+        if (_buffer.empty()) break;
+
+        // everything appended while the previous sync ran goes in one batch
+        string batch{};
+        batch.swap(_buffer);
+        const auto upto = _appended;
+
+        lock.unlock();
+        std::exception_ptr error{};
+        try {
+            write_all(_fd, batch);
+            sync_fd(_fd);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        if (error) _error = error;
+        _durable = upto;
+        _durable_cv.notify_all();
+    }
+}
+
+const string_view& Journal::as_strv(Status st) noexcept {
+    switch (st) {
+        case Status::ACCEPTED:
+            return ACCEPTED_SV;
+        case Status::SUBMITTED:
+            return SUBMITTED_SV;
+        case Status::SUCCEEDED:
+            return SUCCEEDED_SV;
+        case Status::FAILED:
+            return FAILED_SV;
+        default:
+            return FAILED_SV;
+    }
+}
+
+Journal::Journal(fs::path file)
+    : _impl(std::make_unique<_Impl>(std::move(file))) {
+    _impl->load();
+    _impl->compact();
+
+    _impl->_fd = ::open(_impl->_file.c_str(),
+                        O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0640);
+    if (_impl->_fd < 0) throw errno_error("journal open");
+
+    _impl->_committer = std::thread([impl = _impl.get()] {
+        impl->run_committer();
+    });
+}
+
+Journal::Journal(Journal&&) noexcept = default;
+
+Journal::~Journal() {
+    if (!_impl) return;
+    {
+        std::lock_guard<std::mutex> lock(_impl->_mutex);
+        _impl->_stopping = true;
+    }
+    _impl->_commit_cv.notify_all();
+    if (_impl->_committer.joinable()) _impl->_committer.join();
+    if (_impl->_fd >= 0) ::close(_impl->_fd);
+}
+
+const vector<Journal::Entry>& Journal::pending() const& noexcept {
+    return _impl->_pending;
+}
+
+std::optional<Journal::Status> Journal::replayed(const fs::path& file) const {
+    const auto it = _impl->_replayed.find(key(file));
+    if (it == _impl->_replayed.end()) return std::nullopt;
+    return it->second;
+}
+
+void Journal::record(const fs::path& file, Status status) {
+    std::unique_lock<std::mutex> lock(_impl->_mutex);
+    if (_impl->_error) std::rethrow_exception(_impl->_error);
+
+    _impl->_buffer += fmt::format("{} {}\n",
+                                  CODES[static_cast<size_t>(status)],
+                                  key(file).string());
+    const auto ticket = ++_impl->_appended;
+    _impl->_commit_cv.notify_one();
+
+    _impl->_durable_cv.wait(lock,
+                            [&] { return _impl->_durable >= ticket; });
+    if (_impl->_error) std::rethrow_exception(_impl->_error);
+}
+
+}  // namespace spool
@@ -1,20 +1,40 @@
 #include "args.hpp"
+#include "bounded_queue.hpp"
+#include "checkpoint.hpp"
 #include "device.hpp"
+#include "device_pool.hpp"
+#include "inbox_mirror.hpp"
+#include "journal.hpp"
+#include "metrics.hpp"
+#include "reactor.hpp"
+#include "receiver.hpp"
+#include "rpc_recording.hpp"
+#include "scheduler.hpp"
+#include "sms_text.hpp"
+#include "spool_file.hpp"
+#include "trace.hpp"
 
 #include <signal.h>
+#include <sys/epoll.h>
 #include <sysexits.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <exception>
 #include <filesystem>
-#include <fstream>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <ranges>
-#include <sstream>
+#include <set>
 #include <string>
 #include <string_view>
+#include <system_error>
 #include <thread>
 #include <vector>
 
@@ -25,7 +45,6 @@
 
 #include "inotify-cpp/NotifierBuilder.h"
 #include "lambda_signal.hpp"
-#include "string_trim.hpp"
 
 namespace fs = std::filesystem;
 
@@ -38,15 +57,173 @@ using std::string;
 using std::vector;
 using std::chrono::minutes;
 using std::chrono::seconds;
+using std::chrono::steady_clock;
+using std::chrono::system_clock;
 
 using level_enum = spdlog::level::level_enum;
 
+constexpr auto METRICS_HOST = "127.0.0.1"sv;
+
 using namespace messages;
 
-Device DefaultDevice(aux::Args& args);
+/// the rpc traffic of every device is recorded into or served from these
+struct Capture {
+    staff::Recorder* recorder;
+    staff::Replay*   replay;
+};
+
+DevicePool DefaultPool(aux::Args& args, const Capture& capture);
+
+using spool::Checkpoint;
+using spool::Journal;
+using spool::Scheduler;
+using spool::Trace;
+
+/// files from their queueing to their final state: the watch and the
+/// startup scan may both report the same one
+class InFlight {
+    std::mutex         _mutex;
+    std::set<fs::path> _files;
+
+   public:
+    bool claim(const fs::path& file) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _files.insert(fs::absolute(file).lexically_normal()).second;
+    }
+
+    void release(const fs::path& file) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _files.erase(fs::absolute(file).lexically_normal());
+    }
+};
+
+/// counters of the spool files in the metrics registry
+struct Tally {
+    metrics::Counter& accepted;
+    metrics::Counter& sent;
+    metrics::Counter& failed;
+    metrics::Counter& retried;  // accepted before a restart, queued again
+};
+
+const Tally& tally();
+
+/// receive mode: polls every dongle of the pool for received SMSes on its
+/// own thread until stopped
+class ReceiveLoop {
+    std::mutex              _mutex;
+    std::condition_variable _cv;
+    bool                    _stopping;
+    std::thread             _thread;
+
+   public:
+    ReceiveLoop(DevicePool& pool, spool::Receiver& receiver, seconds interval)
+        : _stopping{} {
+        auto& received = metrics::registry().counter(
+            "asmsd_sms_received_total", "received SMSes written to a file");
+        _thread = std::thread([this, &pool, &receiver, &received, interval]() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            do {
+                lock.unlock();
+                for (size_t i{}; i < pool.size(); ++i) {
+                    try {
+                        const auto n = receiver.poll(
+                            pool.at(i), fmt::format("GSM{}", i + 1));
+                        if (n > 0) spdlog::info("received {} SMS", n);
+                        received.inc(n);
+                    } catch (const std::exception& e) {
+                        spdlog::error("unable to receive SMS: {}", e.what());
+                    }
+                }
+                lock.lock();
+            } while (
+                !_cv.wait_for(lock, interval, [this] { return _stopping; }));
+        });
+    }
+
+    ~ReceiveLoop() {
+        stop();
+        wait();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _cv.notify_all();
+    }
+
+    void wait() {
+        if (_thread.joinable()) _thread.join();
+    }
+};
+
+/// a file reported by the watch or the scan
+struct Arrival {
+    fs::path                 file;
+    steady_clock::time_point seen;
+};
+
+/// paths from the watch to the parser workers, the watch never waits
+/// for reading a file, only for room when the parsers are behind
+using Intake = spool::BoundedQueue<Arrival>;
+
+/// the watch mode outbound path, shared by the notifier and the senders
+struct Outbound {
+    DevicePool&     pool;
+    Journal*        journal;
+    Checkpoint*     checkpoint;
+    Trace*          trace;
+    Intake&         intake;
+    Scheduler&      scheduler;
+    const fs::path& watch;
+    const fs::path& move_to;
+    size_t          max_recipients;
+    size_t          max_segments;
+    OverLength      over_length;
+    size_t          max_file_size;
+    InFlight        in_flight;
+};
+
+vector<string> prepare_text(string content, size_t max_segments,
+                            OverLength policy);
+
+void queue_file(Outbound& out, const fs::path& file,
+                steady_clock::time_point seen);
+
+void resume_file(Outbound& out, const Journal::Entry& entry);
+
+void send_message(Outbound& out, spool::Message msg);
+
+/// the part of a message some recipients did not get, as a new spool file
+/// next to its first file, so the watch takes it like any other
+void write_retry_file(const spool::Message& msg, const string& text,
+                      const vector<string>& nums, size_t part);
 
-void process_file(Device& client, const fs::path& file,
-                  const fs::path& move_to);
+/// a command of the arguments the mirror does not answer
+bool asks_device(const aux::Args& args);
+
+/// a command of the arguments sent to the primary dongle, the watch and
+/// the receive loop take any dongle of the pool
+bool asks_primary(const aux::Args& args);
+
+/// prints the lists and searches asked from the mirror, false if none
+bool print_mirror(const aux::Args& args, const InboxMirror& mirror);
+
+/// queues the files arrived while the daemon was not watching: newer than
+/// the checkpoint, or without one in the reprocess window; they are parsed
+/// on worker threads while the senders drain the queue
+void reprocess(Outbound& out, system_clock::time_point since,
+               const std::atomic<bool>& stopping);
+
+/// watch mode with the notifier and the keepalive on their own threads,
+/// armed() is called once the directory is watched
+void watch_threads(Outbound& out, DevicePool& pool,
+                   const std::function<void()>& armed);
+
+/// watch mode with one epoll loop for the watch, keepalive and signals
+void watch_reactor(Outbound& out, DevicePool& pool, seconds keepalive,
+                   const std::function<void()>& armed);
 
 int main(int argc, const char* argv[]) {
     spdlog::flush_on(spdlog::level::err);
@@ -71,63 +248,142 @@ int main(int argc, const char* argv[]) {
                      spdlog::level::to_string_view(spdlog::get_level()));
     }
 
+    // the signals of the event loop have to be blocked before any thread
+    // starts, otherwise they are delivered to the device threads
+    if (args.reactor() && !args.watch().empty())
+        spool::Reactor::block({SIGINT, SIGTERM});
+
+    const auto over_length = over_length_from(args.over_length());
+    if (!over_length) {
+        fmt::print(stderr,
+                   "unknown --over-length {}, see usage: asmsd --help\n",
+                   args.over_length());
+        std::exit(EX_USAGE);
+    }
+
     try {
         spdlog::debug("using host: {}, port: {}", args.host(), args.port());
 
-        auto device = DefaultDevice(args);
+        // outlive the pool, its devices use them
+        std::optional<staff::Recorder> recorder{};
+        std::optional<staff::Replay>   replay{};
+        if (!args.record().empty()) {
+            spdlog::info("recording rpc traffic into {}",
+                         args.record().string());
+            recorder.emplace(args.record());
+        }
+        if (!args.replay().empty()) {
+            spdlog::info("replaying rpc traffic of {} at {}x speed",
+                         args.replay().string(), args.replay_speed());
+            replay.emplace(args.replay(), args.replay_speed());
+        }
+
+        auto  pool   = DefaultPool(args, {recorder ? &*recorder : nullptr,
+                                          replay ? &*replay : nullptr});
+        auto& device = pool.primary();
+
+        // the lists and searches are answered from the mirror, without the
+        // device unless it is synced or asked for something else
+        std::optional<InboxMirror> mirror{};
+        if (!args.mirror().empty()) {
+            mirror.emplace(args.mirror());
+            if (!args.sync() && !asks_device(args)) {
+                if (!print_mirror(args, *mirror))
+                    fmt::print(stderr,
+                               "no command specified, see usage: asmsd "
+                               "--help\n");
+                std::exit(EXIT_SUCCESS);
+            }
+        }
 
         spdlog::debug("wating for device to be alive...");
-        device.wait_alive();
+        if (asks_primary(args))
+            device.wait_alive();
+        else
+            pool.wait_alive();
 
         bool specified{};
 
+        if (mirror) {
+            if (args.sync()) {
+                const auto stats = mirror->sync(device);
+                if (stats.unchanged)
+                    spdlog::info("mirror {} is up to date",
+                                 args.mirror().string());
+                else
+                    spdlog::info(
+                        "mirror {} synced: {} contacts fetched, {} SMSes "
+                        "added, {} removed",
+                        args.mirror().string(), stats.contacts, stats.added,
+                        stats.removed);
+                specified = true;
+            }
+            specified |= print_mirror(args, *mirror);
+        }
+
+        // the status views are fetched in one round trip
+        Device::StatePtr snapshot{};
+        if (args.system_info() || args.system_status() ||
+            args.connection_state() || args.sms_storage_state()) {
+            snapshot = device.snapshot();
+            if (!snapshot->system_status)
+                throw std::runtime_error{"device is not alive"};
+        }
+
         if (args.system_info()) {
-            const auto& sys_inf = device.system_info();
+            const auto sys_inf = snapshot->system_info;
             if (args.detailed())
-                fmt::print("{:d}\n", sys_inf);
+                fmt::print("{:d}\n", *sys_inf);
             else
-                fmt::print("{}\n", sys_inf);
+                fmt::print("{}\n", *sys_inf);
             specified = true;
         }
 
         if (args.system_status()) {
-            const auto& sys_status = device.system_status();
+            const auto sys_status = snapshot->system_status;
             if (args.detailed())
-                fmt::print("{:d}\n", sys_status);
+                fmt::print("{:d}\n", *sys_status);
             else
-                fmt::print("{}\n", sys_status);
+                fmt::print("{}\n", *sys_status);
             specified = true;
         }
 
         if (args.connection_state()) {
-            const auto& con_state = device.connection_state();
+            const auto con_state = snapshot->connection_state;
             if (args.detailed())
-                fmt::print("{:d}\n", con_state);
+                fmt::print("{:d}\n", *con_state);
             else
-                fmt::print("{}\n", con_state);
+                fmt::print("{}\n", *con_state);
             specified = true;
         }
 
         if (args.sms_storage_state()) {
-            const auto& sms_state = device.sms_storage_state();
-            fmt::print("{}\n", sms_state);
+            const auto sms_state = snapshot->sms_storage_state;
+            fmt::print("{}\n", *sms_state);
             specified = true;
         }
 
-        if (args.sms_contact_list()) {
-            const auto& sms_clist = device.sms_contacts(args.page());
-            fmt::print("{}\n", sms_clist);
+        if (args.sms_contact_list() && !mirror) {
+            if (args.all_pages())
+                for (const auto& sms_clist :
+                     device.all_sms_contacts(args.page()))
+                    fmt::print("{}\n", sms_clist);
+            else
+                fmt::print("{}\n", device.sms_contacts(args.page()));
             specified = true;
         }
 
-        if (args.sms_content_list() > 0) {
+        if (args.sms_content_list() > 0 &&
+            (!mirror || args.delete_sms() > 0)) {
             if (args.delete_sms() > 0)
                 device.delete_sms(args.sms_content_list(), args.delete_sms());
-            else {
-                const auto& sms_clist =
-                    device.sms_contents(args.sms_content_list(), args.page());
-                fmt::print("{}\n", sms_clist);
-            }
+            else if (args.all_pages())
+                for (const auto& sms_clist : device.all_sms_contents(
+                         args.sms_content_list(), args.page()))
+                    fmt::print("{}\n", sms_clist);
+            else
+                fmt::print("{}\n", device.sms_contents(
+                                       args.sms_content_list(), args.page()));
             specified = true;
         }
 
@@ -139,12 +395,14 @@ int main(int argc, const char* argv[]) {
                 std::exit(EX_USAGE);
             }
 
-            const auto res = device.send_sms(
-                std::move(args).send_sms(), 
-                std::move(args).content()
-            );
+            const auto texts = prepare_text(std::move(args).content(),
+                                            args.max_segments(), *over_length);
+            if (texts.empty()) std::exit(EX_DATAERR);
 
-            spdlog::debug("SMS send status: {}", res.send_status_sv());
+            for (const auto& text : texts) {
+                const auto res = device.send_sms(args.send_sms(), text);
+                spdlog::debug("SMS send status: {}", res.send_status_sv());
+            }
 
             specified = true;
         }
@@ -154,6 +412,22 @@ int main(int argc, const char* argv[]) {
             specified = true;
         }
 
+        std::optional<spool::Receiver> receiver{};
+        std::optional<ReceiveLoop>     receive_loop{};
+        if (!args.receive().empty()) {
+            if (!fs::is_directory(args.receive())) {
+                spdlog::error("receive path: {} is not a directory",
+                              args.receive().string());
+                std::exit(EX_USAGE);
+            }
+            spdlog::info("writing received SMSes into {}",
+                         args.receive().string());
+            receiver.emplace(args.receive(), args.receive_state(),
+                             args.receive_interval());
+            receive_loop.emplace(pool, *receiver, args.receive_interval());
+            specified = true;
+        }
+
         if (!args.watch().empty()) {
             const auto watch_string = args.watch().string();
             if (!fs::is_directory(args.watch())) {
@@ -162,96 +436,190 @@ int main(int argc, const char* argv[]) {
                 std::exit(EX_USAGE);
             }
 
-            if (args.reprocess() > 0min) {
-                const auto since =
-                    std::chrono::file_clock::now() - args.reprocess();
-                spdlog::info("reprocessing files since {:%H:%M:%S}",
-                             std::chrono::file_clock::to_sys(since));
+            std::optional<Journal> journal{};
+            if (!args.journal().empty()) {
+                spdlog::debug("replaying journal: {}", args.journal().string());
+                journal.emplace(args.journal());
+            }
+            Journal* const journal_ptr = journal ? &*journal : nullptr;
 
-                try {
-                    for (const auto& dir_entry :
-                         fs::directory_iterator{args.watch()}) {
-                        try {
-                            if (dir_entry.is_regular_file() &&
-                                dir_entry.last_write_time() >= since) {
-                                spdlog::debug("reprocessing file: {}",
-                                              dir_entry.path().string());
-                                process_file(device, dir_entry.path(),
-                                             args.move_to());
-                            }
-                        } catch (const std::exception& e) {
-                            spdlog::error("unable to get director entry: {}",
-                                          e.what());
-                        }
-                    }
-                } catch (const std::exception& e) {
-                    spdlog::error("unable to iterate in directory entries: {}",
-                                  e.what());
-                }
+            std::optional<Checkpoint> checkpoint{};
+            if (!args.checkpoint().empty())
+                checkpoint.emplace(args.checkpoint());
+            Checkpoint* const checkpoint_ptr =
+                checkpoint ? &*checkpoint : nullptr;
+
+            std::optional<Trace> trace{};
+            if (!args.trace().empty()) trace.emplace(args.trace());
+            Trace* const trace_ptr = trace ? &*trace : nullptr;
+
+            Intake    intake{args.intake_queue()};
+            Scheduler scheduler{args.aging(),
+                                {args.coalesce(), args.digest_segments()},
+                                args.fanout()};
+            Outbound  outbound{pool,
+                              journal_ptr,
+                              checkpoint_ptr,
+                              trace_ptr,
+                              intake,
+                              scheduler,
+                              args.watch(),
+                              args.move_to(),
+                              args.max_recipients(),
+                              args.max_segments(),
+                              *over_length,
+                              args.max_file_size(),
+                              {}};
+
+            // declared after the sampled stages, so it stops before them
+            auto& reg = metrics::registry();
+            reg.sample(metrics::Registry::Type::GAUGE, "asmsd_queue_depth",
+                       "spool files waiting in a stage", {{"stage", "intake"}},
+                       [&intake]() {
+                           return static_cast<double>(intake.stats().depth);
+                       });
+            reg.sample(metrics::Registry::Type::GAUGE, "asmsd_queue_depth",
+                       "spool files waiting in a stage",
+                       {{"stage", "scheduler"}}, [&scheduler]() {
+                           return static_cast<double>(scheduler.size());
+                       });
+            reg.sample(metrics::Registry::Type::COUNTER,
+                       "asmsd_intake_full_waits_total",
+                       "watched files waited for room in the intake queue",
+                       {}, [&intake]() {
+                           return static_cast<double>(
+                               intake.stats().full_waits);
+                       });
+            std::optional<metrics::Server> metrics_server{};
+            if (args.metrics_port() > 0) {
+                spdlog::info("serving metrics on http://{}:{}/metrics",
+                             METRICS_HOST, args.metrics_port());
+                metrics_server.emplace(reg, string{METRICS_HOST},
+                                       args.metrics_port());
             }
 
-            spdlog::debug("start watching directory for file creation: {}",
-                          watch_string);
-            auto notifier =
-                BuildNotifier()
-                    .watchPathRecursively(args.watch())
-                    .onEvents(
-                        {inotify::Event::create, inotify::Event::moved_to},
-                        [&device,
-                         &mv_to = args.move_to()](inotify::Notification notif) {
-                            if (fs::is_regular_file(notif.path)) {
-                                spdlog::debug("new file created at {}",
-                                              notif.path.string());
-                                process_file(device, notif.path, mv_to);
-                            }
-                        });
-
-            spdlog::debug(
-                "registring stop signal: press ^C to stop watching...");
-            SignalScope<SIGINT> sigint([&device](int sig) {
-                spdlog::debug("got signal {}, stopping keepalive...", sig);
-                device.stop_keepalive();
-            });
+            if (journal)
+                for (const auto& entry : journal->pending())
+                    resume_file(outbound, entry);
 
-            spdlog::debug("start running notifier on watch thread...");
-            std::thread watch_thread([&notifier]() {
-                notifier.run();
-                spdlog::debug("notifier stoped running...");
-            });
+            // one sender per dongle: a waiting CRITICAL message gets the
+            // next free send slot whatever the backlog is
+            spdlog::debug("start running {} sender threads...", pool.size());
+            vector<std::thread> sender_threads{};
+            for (size_t i{}; i < pool.size(); ++i)
+                sender_threads.emplace_back([&outbound]() {
+                    while (auto msg = outbound.scheduler.pop())
+                        send_message(outbound, std::move(*msg));
+                });
 
-            spdlog::debug("start running keepalive thread...");
-            std::thread keepalive_thread([&notifier, &device,
-                                          &path = args.watch()]() {
-                device.run_keepalive([&](Device& d) {
-                    spdlog::error("device went offline... unwatch directory");
-                    notifier.unwatchFile(path);
-                    spdlog::info("waiting for device to be alive...");
-                    d.wait_alive();
-                    spdlog::info(
-                        "device came back online, start watching again...");
-                    notifier.watchFile(path);
-                    return d.is_running();
+            spdlog::debug("start running {} parser threads...",
+                          args.parsers());
+            vector<std::thread> parser_threads{};
+            for (size_t i{}; i < std::max<size_t>(1, args.parsers()); ++i)
+                parser_threads.emplace_back([&outbound]() {
+                    while (auto arrival = outbound.intake.pop()) {
+                        std::error_code ec{};
+                        if (fs::is_regular_file(arrival->file, ec))
+                            queue_file(outbound, arrival->file,
+                                       arrival->seen);
+                    }
                 });
-                spdlog::debug("keepalive stoped running...");
-            });
 
-            spdlog::debug("wating for keepalive thread to stop...");
-            keepalive_thread.join();
-            spdlog::info("keepalive thread stoped");
+            // the scan starts once the watch is armed, so no file written
+            // meanwhile is missed; the in flight set drops the doubles
+            const bool scan = args.reprocess() > 0min ||
+                              (checkpoint && !checkpoint->empty());
+            const auto        since = system_clock::now() - args.reprocess();
+            std::atomic<bool> stopping{};
+            std::thread       reprocess_thread{};
+            const auto        armed = [&]() {
+                if (!scan) return;
+                reprocess_thread = std::thread([&]() {
+                    reprocess(outbound, since, stopping);
+                });
+            };
+
+            // held before the watch is armed: the files it takes must not
+            // move the saved checkpoint over the backlog not taken yet
+            if (scan && checkpoint) checkpoint->hold();
 
-            spdlog::debug("stoping notifier...");
-            notifier.stop();
-            spdlog::debug("waiting for watch thread to stop...");
-            watch_thread.join();
-            spdlog::info("watch thread stoped");
+            if (args.reactor())
+                watch_reactor(outbound, pool, args.keep_alive(), armed);
+            else
+                watch_threads(outbound, pool, armed);
+
+            stopping = true;
+            if (reprocess_thread.joinable()) reprocess_thread.join();
+
+            intake.close();
+            for (auto& parser_thread : parser_threads) parser_thread.join();
+            const auto intake_stats = intake.stats();
+            spdlog::info(
+                "intake queue: {} files, {} high water of {}, {} waits for "
+                "room",
+                intake_stats.pushed, intake_stats.high_water,
+                intake.capacity(), intake_stats.full_waits);
+            if (checkpoint) {
+                try {
+                    checkpoint->save();
+                } catch (const std::exception& e) {
+                    spdlog::error("unable to save checkpoint: {}", e.what());
+                }
+            }
+
+            spdlog::debug("stopping senders, {} messages left in queue...",
+                          scheduler.size());
+            scheduler.stop();
+            // a sender waiting for a dongle gives up once the pool stops
+            pool.stop_keepalive();
+            for (auto& sender_thread : sender_threads) sender_thread.join();
+            spdlog::info("sender threads stoped");
+
+            if (trace) {
+                for (const auto& sum : trace->summary())
+                    spdlog::info("stage {}: {} messages, p50 {}, p99 {}",
+                                 Trace::as_strv(sum.stage), sum.count,
+                                 sum.p50, sum.p99);
+                try {
+                    trace->write_summary();
+                } catch (const std::exception& e) {
+                    spdlog::error("unable to write trace summary: {}",
+                                  e.what());
+                }
+            }
+
+            for (size_t i{}; i < pool.size(); ++i) {
+                const auto stats = pool.at(i).connection_stats();
+                spdlog::info(
+                    "http session #{}: {} requests, {} reused, {} connects, "
+                    "{} errors",
+                    i, stats.requests, stats.reused, stats.connects,
+                    stats.errors);
+            }
 
             specified = true;
         }
 
+        if (receive_loop) {
+            if (args.watch().empty()) {
+                spdlog::debug("receiving: press ^C to stop...");
+                SignalScope<SIGINT>  sigint([&](int) { receive_loop->stop(); });
+                SignalScope<SIGTERM> sigterm(
+                    [&](int) { receive_loop->stop(); });
+                receive_loop->wait();
+            }
+            receive_loop.reset();
+            spdlog::info("receive thread stoped");
+        }
+
         if (!specified)
             fmt::print(stderr,
                        "no command specified, see usage: asmsd --help\n");
 
+        if (replay && replay->left() > 0)
+            spdlog::warn("{} recorded exchanges of {} were not replayed",
+                         replay->left(), args.replay().string());
+
     } catch (const std::exception& e) {
         spdlog::critical("json rpc request error: {}", e.what());
         std::exit(EX_SOFTWARE);
@@ -260,90 +628,593 @@ int main(int argc, const char* argv[]) {
     std::exit(EXIT_SUCCESS);
 }
 
-void process_file(Device& client, const fs::path& file,
-                  const fs::path& move_to) {
+bool asks_device(const aux::Args& args) {
+    return asks_primary(args) || !args.watch().empty() ||
+           !args.receive().empty();
+}
+
+bool asks_primary(const aux::Args& args) {
+    const bool lists = args.mirror().empty() &&
+                       (args.sms_contact_list() || args.sms_content_list() > 0);
+    return args.system_info() || args.system_status() ||
+           args.connection_state() || args.sms_storage_state() ||
+           !args.send_sms().empty() || args.delete_sms() > 0 || args.sync() ||
+           lists;
+}
+
+bool print_mirror(const aux::Args& args, const InboxMirror& mirror) {
+    bool specified{};
+
+    if (args.sms_contact_list()) {
+        fmt::print("{}\n", mirror.contacts());
+        specified = true;
+    }
+
+    if (args.sms_content_list() > 0 && args.delete_sms() <= 0) {
+        fmt::print("{}\n", mirror.contents(args.sms_content_list()));
+        specified = true;
+    }
+
+    if (!args.search().empty() || !args.phone().empty() ||
+        args.since() > minutes{}) {
+        const auto since =
+            args.since() > minutes{}
+                ? system_clock::to_time_t(system_clock::now() - args.since())
+                : std::time_t{};
+        for (const auto& sms : mirror.find(args.phone(), args.search(), since))
+            fmt::print("{}", sms);
+        specified = true;
+    }
+
+    return specified;
+}
+
+const Tally& tally() {
+    auto&              reg = metrics::registry();
+    static const Tally instance{
+        reg.counter("asmsd_messages_accepted_total",
+                    "spool files queued for sending"),
+        reg.counter("asmsd_messages_sent_total", "spool files sent"),
+        reg.counter("asmsd_messages_failed_total",
+                    "spool files failed to send"),
+        reg.counter("asmsd_messages_retried_total",
+                    "spool files queued again after a restart")};
+    return instance;
+}
+
+void journal_record(Journal* journal, const fs::path& file,
+                    Journal::Status status) {
+    if (!journal) return;
+    try {
+        journal->record(file, status);
+    } catch (const std::exception& e) {
+        spdlog::error("unable to record {} state of {} in journal: {}",
+                      Journal::as_strv(status), file.string(), e.what());
+    }
+}
+
+void move_file(const fs::path& file, const fs::path& move_to) {
+    if (!move_to.empty()) {
+        spdlog::debug("moving file {} to {}", file.filename().string(),
+                      move_to.string());
+        try {
+            fs::rename(file, move_to / file.filename());
+        } catch (const std::exception& e) {
+            spdlog::error("unable to move file: {}", e.what());
+        }
+    }
+}
+
+std::optional<spool::Message> read_file(const fs::path& file,
+                                        const Outbound& out,
+                                        steady_clock::time_point seen) {
     const auto path_string = file.string();
 
-    std::ifstream in_file{file};
-    if (!in_file) {
-        spdlog::error("unable to open file: {}", path_string);
+    spool::Message msg{{file}, {}, {}, spool::Priority::NORMAL, {}, seen, {}};
+
+    // a sub directory of the watched one may name the priority class
+    const auto relative = file.lexically_relative(out.watch);
+    if (std::distance(relative.begin(), relative.end()) > 1)
+        if (const auto prio = spool::priority_from(relative.begin()->string()))
+            msg.priority = *prio;
+
+    try {
+        auto       text  = spool::read_spool_file(file, out.max_file_size);
+        const auto spool = spool::parse_spool_file(text);
+
+        msg.phone_numbers.assign(spool.to.begin(), spool.to.end());
+        if (!spool.priority.empty()) {
+            if (const auto prio = spool::priority_from(spool.priority))
+                msg.priority = *prio;
+            else
+                spdlog::warn("unknown priority {} in {}, using {}",
+                             spool.priority, path_string,
+                             spool::as_strv(msg.priority));
+        }
+        if (spool.flash)
+            spdlog::warn("flash SMS is sent as a normal one from {}",
+                         path_string);
+
+        msg.content = spool::take_body(std::move(text), spool);
+    } catch (const std::exception& e) {
+        spdlog::error("unable to read in file {}: {}", path_string, e.what());
+        return std::nullopt;
+    }
+
+    if (!valid_utf8(msg.content)) {
+        spdlog::warn("invalid utf-8 in {}, replaced with '?'", path_string);
+        msg.content = sanitize_utf8(msg.content);
+    }
+    msg.parsed = steady_clock::now();
+    return msg;
+}
+
+void queue_file(Outbound& out, const fs::path& file,
+                steady_clock::time_point seen) {
+    // written under a hidden name, taken once it is renamed
+    if (file.filename().string().starts_with('.')) return;
+    if (!out.in_flight.claim(file)) {
+        spdlog::debug("file {} is queued already", file.string());
+        return;
+    }
+
+    const auto stamp = spool::stamp_of(file);
+    auto       msg   = read_file(file, out, seen);
+    if (!msg) {
+        out.in_flight.release(file);
         return;
     }
 
-    std::stringstream content{};
-    string            phone_number{};
+    journal_record(out.journal, file, Journal::Status::ACCEPTED);
+    tally().accepted.inc();
+    if (out.checkpoint && stamp) out.checkpoint->take(file, *stamp);
+    spdlog::debug("queueing {} SMS from: {}", spool::as_strv(msg->priority),
+                  file.string());
+    msg->queued = steady_clock::now();
+    out.scheduler.push(std::move(*msg));
+}
+
+void resume_file(Outbound& out, const Journal::Entry& entry) {
+    if (!fs::is_regular_file(entry.path)) return;
+
+    if (entry.status == Journal::Status::SUBMITTED) {
+        // posted to a dongle before the stop without a known result:
+        // sending again could deliver it twice, so it is left for review
+        spdlog::warn(
+            "file {} was posted before the restart with an unknown result, "
+            "left for review",
+            entry.path.string());
+        return;
+    }
+    spdlog::debug("resending accepted file: {}", entry.path.string());
+    tally().retried.inc();
+    queue_file(out, entry.path, steady_clock::now());
+}
+
+void trace_message(const Outbound& out, const spool::Message& msg,
+                   Trace::Stamps& stamps, bool succeeded) {
+    if (!out.trace) return;
+    stamps[static_cast<size_t>(Trace::Stage::SEEN)]   = msg.seen;
+    stamps[static_cast<size_t>(Trace::Stage::PARSED)] = msg.parsed;
+    stamps[static_cast<size_t>(Trace::Stage::QUEUED)] = msg.queued;
     try {
-        string line{};
-        while (!(line.starts_with("To") || line.starts_with("to"))) {
-            line.clear();
-            if (!std::getline(in_file, line)) break;
+        out.trace->record(msg.files, stamps, succeeded);
+    } catch (const std::exception& e) {
+        spdlog::error("unable to write trace: {}", e.what());
+    }
+}
+
+void write_retry_file(const spool::Message& msg, const string& text,
+                      const vector<string>& nums, size_t part) {
+    const auto& file = msg.files.front();
+    string      data{};
+    for (const auto& num : nums) data += fmt::format("To: {}\n", num);
+    data += fmt::format("Priority: {}\n\n", spool::as_strv(msg.priority));
+    data += text;
+
+    const auto name = fmt::format("{}.retry{}", file.filename().string(), part);
+    spool::write_spool_file(file.parent_path(), name, data);
+    spdlog::warn("SMS from {} to {} is sent again from {}", file.string(),
+                 fmt::join(nums, ", "), name);
+}
+
+void send_message(Outbound& out, spool::Message msg) {
+    Trace::Stamps stamps{};
+    const auto    record = [&](Journal::Status st) {
+        for (const auto& file : msg.files) {
+            journal_record(out.journal, file, st);
+            if (!Journal::is_final(st)) continue;
+            out.in_flight.release(file);
+            // a failed file stays taken, the next scan tries it again
+            if (!out.checkpoint || st == Journal::Status::FAILED) continue;
+            try {
+                out.checkpoint->advance(file);
+            } catch (const std::exception& e) {
+                spdlog::error("unable to save checkpoint: {}", e.what());
+            }
         }
-        if (line.empty()) {
-            spdlog::error("no To field specified in file");
-            return;
+        if (st == Journal::Status::SUCCEEDED)
+            tally().sent.inc(msg.files.size());
+        if (st == Journal::Status::FAILED) {
+            tally().failed.inc(msg.files.size());
+            trace_message(out, msg, stamps, false);
         }
-        if (const auto i = line.find_last_of(':'); i > 0) {
-            if (i + 1 < line.size()) {
-                phone_number = line.substr(i + 1);
-                trim(phone_number);
-            } else {
-                spdlog::error("no value in to field (empty)");
-                return;
+    };
+    spdlog::debug("sending SMS of {} files to: {}", msg.files.size(),
+                  fmt::join(msg.phone_numbers, ", "));
+
+    const auto texts = prepare_text(std::move(msg.content), out.max_segments,
+                                    out.over_length);
+    if (texts.empty()) {
+        spdlog::error("SMS from {} is rejected", msg.files.front().string());
+        record(Journal::Status::FAILED);
+        return;
+    }
+
+    // journaled once the first request is posted by a sender thread, a
+    // file queued but never posted is sent again after a crash
+    const auto posted    = std::make_shared<std::once_flag>();
+    const auto on_posted = [posted, journal = out.journal, files = msg.files] {
+        std::call_once(*posted, [&] {
+            for (const auto& file : files)
+                journal_record(journal, file, Journal::Status::SUBMITTED);
+        });
+    };
+
+    // more recipients than one request takes or a split text: all the
+    // requests are queued at once, then every result is collected
+    struct Request {
+        const string*      text;
+        vector<string>     nums;
+        Device::SendFuture result;
+    };
+    const auto chunk = std::max<size_t>(1, out.max_recipients);
+    const auto nums  = std::move(msg.phone_numbers);
+    vector<Request>                            requests{};
+    vector<std::shared_ptr<Device::SendTimes>> times{};
+    bool                                       stopped{};
+    for (const auto& text : texts)
+        for (size_t i{}; i < nums.size(); i += chunk) {
+            auto& req = requests.emplace_back(Request{
+                &text,
+                {nums.begin() + i,
+                 nums.begin() + std::min(i + chunk, nums.size())},
+                {}});
+            times.push_back(std::make_shared<Device::SendTimes>());
+            times.back()->on_posted = on_posted;
+            if (stopped) continue;
+            try {
+                req.result = out.pool.send_sms_async(req.nums, text,
+                                                     times.back());
+            } catch (const DevicePool::NotInRotation&) {
+                stopped = true;
+            } catch (const std::exception& e) {
+                spdlog::error("unable to queue sms from {}: {}",
+                              msg.files.front().string(), e.what());
             }
-        } else {
-            spdlog::error("no separator ':' specified in To field");
-            return;
         }
 
-        line.clear();
-        while (std::getline(in_file, line) && !line.empty()) line.clear();
+    vector<const Request*> failed{};
+    for (auto& req : requests) {
+        try {
+            if (req.result.valid()) {
+                const auto status = req.result.get().send_status;
+                if (status == SendSmsResult::SUCCESS) continue;
+                spdlog::error("unable to send sms from {} to {}: {}",
+                              msg.files.front().string(),
+                              fmt::join(req.nums, ", "),
+                              SendSmsResult::as_strv(status));
+            }
+        } catch (const std::exception& e) {
+            spdlog::error("unable to send sms from {} to {}: {}",
+                          msg.files.front().string(),
+                          fmt::join(req.nums, ", "), e.what());
+        }
+        failed.push_back(&req);
+    }
 
-        content << in_file.rdbuf();
-    } catch (const std::exception& e) {
-        spdlog::error("unable to read in file {} content: {}", path_string,
-                      e.what());
+    // the stages of more requests are taken from the first one reaching
+    // them, the results are all in when it is sent
+    const auto first = [&stamps](Trace::Stage st, auto t) {
+        auto& at = stamps[static_cast<size_t>(st)];
+        if (t != steady_clock::time_point{} &&
+            (at == steady_clock::time_point{} || t < at))
+            at = t;
+    };
+    for (const auto& t : times) {
+        first(Trace::Stage::POSTED, t->posted);
+        first(Trace::Stage::POLLED, t->polled);
+    }
+    // stopped with no dongle in rotation: not sent at all, it stays
+    // accepted and is sent again on the next start
+    if (failed.size() == requests.size() && stopped) {
+        spdlog::warn("SMS from {} is left for the next start",
+                     msg.files.front().string());
+        for (const auto& file : msg.files) out.in_flight.release(file);
+        return;
+    }
+    if (failed.size() == requests.size()) {
+        record(Journal::Status::FAILED);
         return;
     }
 
-    spdlog::debug("sending SMS to: {}", phone_number);
+    // the recipients which got it must not get it again: the failed
+    // requests go on in new spool files, the files themselves are done
+    for (size_t i{}; i < failed.size(); ++i) {
+        try {
+            write_retry_file(msg, *failed[i]->text, failed[i]->nums, i + 1);
+        } catch (const std::exception& e) {
+            spdlog::error("SMS from {} is not sent to {}: {}",
+                          msg.files.front().string(),
+                          fmt::join(failed[i]->nums, ", "), e.what());
+        }
+    }
+    if (out.trace)
+        stamps[static_cast<size_t>(Trace::Stage::SENT)] = steady_clock::now();
+
+    record(Journal::Status::SUCCEEDED);
+    for (const auto& file : msg.files) move_file(file, out.move_to);
+    if (out.trace && !out.move_to.empty())
+        stamps[static_cast<size_t>(Trace::Stage::MOVED)] = steady_clock::now();
+    trace_message(out, msg, stamps, true);
+}
+
+vector<string> prepare_text(string content, size_t max_segments,
+                            OverLength policy) {
+    if (!valid_utf8(content)) {
+        spdlog::warn("invalid utf-8 in SMS text, replaced with '?'");
+        content = sanitize_utf8(content);
+    }
+
+    const auto info = inspect(content);
+    spdlog::debug("SMS text of {} {} units in {} segments", info.units,
+                  as_strv(info.alphabet), info.segments);
+    if (max_segments == 0 || policy == OverLength::SEND ||
+        info.segments <= max_segments)
+        return {std::move(content)};
+
+    auto texts = fit(std::move(content), max_segments, policy);
+    if (texts.empty())
+        spdlog::error("SMS text of {} segments is over the {} limit",
+                      info.segments, max_segments);
+    else
+        spdlog::info("SMS text of {} segments is {}: {} SMSes", info.segments,
+                     as_strv(policy), texts.size());
+    return texts;
+}
 
+void reprocess(Outbound& out, system_clock::time_point since,
+               const std::atomic<bool>& stopping) {
+    const bool by_checkpoint = out.checkpoint && !out.checkpoint->empty();
+    const auto since_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            since.time_since_epoch())
+            .count();
+    if (by_checkpoint)
+        spdlog::info("reprocessing files since the checkpoint");
+    else
+        spdlog::info("reprocessing files since {:%H:%M:%S}",
+                     std::chrono::time_point_cast<seconds>(since));
+
+    vector<std::pair<spool::FileStamp, fs::path>> backlog{};
     try {
-        client.send_sms(
-            { std::move(phone_number) }, 
-            std::move(content).str()
-        );
+        for (const auto& entry : fs::recursive_directory_iterator{
+                 out.watch, fs::directory_options::skip_permission_denied}) {
+            if (stopping) return;
+            try {
+                if (!entry.is_regular_file()) continue;
+                // the journal already knows what to do with it, unless it
+                // failed: that is tried again
+                if (const auto st = out.journal
+                                        ? out.journal->replayed(entry.path())
+                                        : std::nullopt;
+                    st && *st != Journal::Status::FAILED)
+                    continue;
+                const auto stamp = spool::stamp_of(entry.path());
+                if (!stamp) continue;
+                if (by_checkpoint ? out.checkpoint->covers(*stamp)
+                                  : stamp->ctime < since_ns)
+                    continue;
+                backlog.emplace_back(*stamp, entry.path());
+            } catch (const std::exception& e) {
+                spdlog::error("unable to get director entry: {}", e.what());
+            }
+        }
     } catch (const std::exception& e) {
-        spdlog::error("unable to send sms: {}", e.what());
-        return;
+        spdlog::error("unable to iterate in directory entries: {}", e.what());
     }
+    std::sort(backlog.begin(), backlog.end(), [](const auto& a, const auto& b) {
+        return a.first.ctime < b.first.ctime;
+    });
 
-    if (!move_to.empty()) {
-        spdlog::debug("moving file {} to {}", file.filename().string(),
-                      move_to.string());
+    const auto scanned = steady_clock::now();
+
+    const auto workers = std::min<size_t>(
+        backlog.size(),
+        std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 8));
+    spdlog::info("reprocessing {} files on {} workers", backlog.size(),
+                 workers);
+
+    std::atomic<size_t> next{};
+    vector<std::thread> threads{};
+    for (size_t w{}; w < workers; ++w)
+        threads.emplace_back([&]() {
+            for (auto i = next++; i < backlog.size() && !stopping; i = next++) {
+                spdlog::debug("reprocessing file: {}",
+                              backlog[i].second.string());
+                queue_file(out, backlog[i].second, scanned);
+            }
+        });
+    for (auto& thread : threads) thread.join();
+
+    if (stopping) return;
+    if (out.checkpoint) {
         try {
-            fs::rename(file, move_to / file.filename());
+            out.checkpoint->release();
         } catch (const std::exception& e) {
-            spdlog::error("unable to move file: {}", e.what());
+            spdlog::error("unable to save checkpoint: {}", e.what());
         }
     }
+    spdlog::info("reprocessing done");
 }
 
-messages::Device DefaultDevice(aux::Args& args) {
+void watch_threads(Outbound& out, DevicePool& pool,
+                   const std::function<void()>& armed) {
+    spdlog::debug("start watching directory for file creation: {}",
+                  out.watch.string());
+    auto notifier =
+        BuildNotifier()
+            .watchPathRecursively(out.watch)
+            .onEvents({inotify::Event::create, inotify::Event::moved_to},
+                      [&out](inotify::Notification notif) {
+                          spdlog::debug("new file created at {}",
+                                        notif.path.string());
+                          out.intake.push(
+                              {std::move(notif.path), steady_clock::now()});
+                      });
+    armed();
+
+    spdlog::debug("registring stop signal: press ^C to stop watching...");
+    SignalScope<SIGINT> sigint([&pool](int sig) {
+        spdlog::debug("got signal {}, stopping keepalive...", sig);
+        pool.stop_keepalive();
+    });
+
+    spdlog::debug("start running notifier on watch thread...");
+    std::thread watch_thread([&notifier]() {
+        notifier.run();
+        spdlog::debug("notifier stoped running...");
+    });
+
+    spdlog::debug("start running keepalive thread...");
+    std::thread keepalive_thread([&notifier, &pool, &path = out.watch]() {
+        pool.run_keepalive([&](DevicePool& p) {
+            spdlog::error("no device is able to send... unwatch directory");
+            notifier.unwatchFile(path);
+            spdlog::info("waiting for a device to be alive...");
+            p.wait_alive();
+            spdlog::info("device came back online, start watching again...");
+            notifier.watchFile(path);
+            return p.is_running();
+        });
+        spdlog::debug("keepalive stoped running...");
+    });
+
+    spdlog::debug("wating for keepalive thread to stop...");
+    keepalive_thread.join();
+    spdlog::info("keepalive thread stoped");
+
+    spdlog::debug("stoping notifier...");
+    notifier.stop();
+    spdlog::debug("waiting for watch thread to stop...");
+    watch_thread.join();
+    spdlog::info("watch thread stoped");
+}
+
+void watch_reactor(Outbound& out, DevicePool& pool, seconds keepalive,
+                   const std::function<void()>& armed) {
+    spool::Reactor        reactor{};
+    spool::DirectoryWatch watch{out.watch};
+    bool                  paused{};
+    armed();
+
+    spdlog::debug("start watching directory for written files: {}",
+                  out.watch.string());
+    reactor.watch(watch.fd(), EPOLLIN, [&out, &watch](std::uint32_t) {
+        for (auto& file : watch.read()) {
+            spdlog::debug("new file written at {}", file.string());
+            out.intake.push({std::move(file), steady_clock::now()});
+        }
+    });
+
+    // the health check is a blocking http round trip per dongle, it runs
+    // on a worker and posts its result back, a tick while it still runs is
+    // skipped; sending stays on the dongle sender threads
+    std::thread checker{};
+    bool        checking{};
+    reactor.every(keepalive, [&]() {
+        if (checking) return;
+        checking = true;
+        if (checker.joinable()) checker.join();
+        checker = std::thread([&]() {
+            pool.refresh_health();
+            reactor.post([&, alive = pool.in_rotation() > 0]() {
+                checking = false;
+                if (!alive && !paused) {
+                    spdlog::error(
+                        "no device is able to send... unwatch directory");
+                    watch.pause();
+                    paused = true;
+                } else if (alive && paused) {
+                    spdlog::info(
+                        "device came back online, start watching again...");
+                    watch.resume();
+                    paused = false;
+                }
+            });
+        });
+    });
+
+    reactor.on_signals({SIGINT, SIGTERM}, [&reactor, &pool](int sig) {
+        spdlog::debug("got signal {}, stopping event loop...", sig);
+        pool.stop_keepalive();
+        reactor.stop();
+    });
+
+    spdlog::debug("start running event loop: press ^C to stop watching...");
+    reactor.run();
+    if (checker.joinable()) checker.join();
+    spdlog::info("event loop stoped");
+}
+
+std::unique_ptr<Device> MakeDevice(const aux::Args& args,
+                                   const Capture& capture, const string& host,
+                                   int port, const string& token) {
+    auto device = std::make_unique<Device>(host, port, args.base_path(),
+                                           args.keep_alive(), args.time_out(),
+                                           2);
+
+    device->session(args.session());
+    device->set_default_headers({
+        {"Content-Type", "application/json"},
+        {"_TclRequestVerificationKey", token},
+        {"_TclRequestVerificationToken", "null"},
+        {"Referer", fmt::format("http://{}/index.html", host)},
+        {"Origin", host},
+    });
+    if (capture.recorder) device->record(capture.recorder);
+    if (capture.replay) device->replay(capture.replay);
+    return device;
+}
+
+messages::DevicePool DefaultPool(aux::Args& args, const Capture& capture) {
     if (args.keep_alive() >= args.time_out()) {
         fmt::print("keep alive value {} have to be smaller then time out {}",
                    args.keep_alive(), args.time_out());
         std::exit(EX_USAGE);
     }
-    messages::Device http_client{args.host(),                 args.port(),
-                                 std::move(args).base_path(), args.keep_alive(),
-                                 args.time_out(),             2};
+    messages::DevicePool pool{args.keep_alive()};
+    pool.add(MakeDevice(args, capture, args.host(), args.port(),
+                        args.verify_token()));
 
-    http_client.set_default_headers({
-        {"Content-Type", "application/json"},
-        {"_TclRequestVerificationKey", std::move(args).verify_token()},
-        {"_TclRequestVerificationToken", "null"},
-        {"Referer", fmt::format("http://{}/index.html", args.host())},
-        {"Origin", std::move(args).host()},
-    });
-    return http_client;
+    for (const auto& spec : args.devices()) {
+        // host[:port[:token]], missing parts are taken from the primary
+        auto       host  = spec.substr(0, spec.find(':'));
+        auto       port  = args.port();
+        auto       token = args.verify_token();
+        const auto i     = spec.find(':');
+        if (i != string::npos) {
+            const auto j = spec.find(':', i + 1);
+            try {
+                port = std::stoi(spec.substr(i + 1, j - i - 1));
+            } catch (const std::exception& e) {
+                spdlog::error("invalid port in device {}: {}", spec, e.what());
+                std::exit(EX_USAGE);
+            }
+            if (j != string::npos) token = spec.substr(j + 1);
+        }
+        spdlog::debug("adding device host: {}, port: {}", host, port);
+        pool.add(MakeDevice(args, capture, host, port, token));
+    }
+    return pool;
 }
\ No newline at end of file
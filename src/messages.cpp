@@ -1,17 +1,427 @@
-#include <sstream>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstring>
 
 #include "fmt/chrono.h"
 #include "fmt/core.h"
 #include "messages_aux.hpp"
 #include "nlohmann/json.hpp"
 
+namespace {
+using namespace std::string_view_literals;
+
+using std::string;
+using std::string_view;
+using std::time_t;
+
+using messages::aux;
+
+/// one scalar member of a result, the text points into the parser
+struct Scalar {
+    std::int64_t number;
+    string_view  text;
+
+    template <typename T>
+    T as() const noexcept {
+        return static_cast<T>(number);
+    }
+};
+
+Scalar scalar_of(const aux::json& j) {
+    switch (j.type()) {
+        case aux::json::value_t::boolean:
+            return {j.get<bool>(), {}};
+        case aux::json::value_t::number_integer:
+        case aux::json::value_t::number_unsigned:
+        case aux::json::value_t::number_float:
+            return {j.get<std::int64_t>(), {}};
+        case aux::json::value_t::string: {
+            const auto& str = j.get_ref<const string&>();
+            Scalar      res{0, str};
+            std::from_chars(str.data(), str.data() + str.size(), res.number);
+            return res;
+        }
+        default:
+            return {};
+    }
+}
+
+/// wall clock fields of a dongle timestamp
+struct Civil {
+    int year;
+    int month;  // 1 based
+    int day;
+    int hour;
+    int minute;
+    int second;
+};
+
+constexpr std::array<string_view, 12> MONTHS = {
+    "jan"sv, "feb"sv, "mar"sv, "apr"sv, "may"sv, "jun"sv,
+    "jul"sv, "aug"sv, "sep"sv, "oct"sv, "nov"sv, "dec"sv};
+
+bool digits(string_view text, size_t pos, size_t count, int& value) {
+    if (pos + count > text.size()) return false;
+    value = 0;
+    for (const auto c : text.substr(pos, count)) {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + (c - '0');
+    }
+    return true;
+}
+
+/// "%Y-%m-%d %H:%M:%S", or "%Y-%b-%d %H:%M:%S" with a month name, in place
+/// of the locale aware get_time
+bool parse_civil(string_view text, bool month_name, Civil& res) {
+    if (!digits(text, 0, 4, res.year) || text.size() < 5 || text[4] != '-')
+        return false;
+    size_t pos = 5;
+    if (month_name) {
+        if (text.size() < pos + 3) return false;
+        char name[3];
+        for (size_t i{}; i < 3; ++i)
+            name[i] = static_cast<char>(text[pos + i] | 0x20);
+        const auto it = std::find(MONTHS.begin(), MONTHS.end(),
+                                  string_view{name, 3});
+        if (it == MONTHS.end()) return false;
+        res.month = static_cast<int>(it - MONTHS.begin()) + 1;
+        pos += 3;
+    } else if (!digits(text, pos, 2, res.month)) {
+        return false;
+    } else {
+        pos += 2;
+    }
+    return text.size() == pos + 12 && text[pos] == '-' &&
+           digits(text, pos + 1, 2, res.day) && text[pos + 3] == ' ' &&
+           digits(text, pos + 4, 2, res.hour) && text[pos + 6] == ':' &&
+           digits(text, pos + 7, 2, res.minute) && text[pos + 9] == ':' &&
+           digits(text, pos + 10, 2, res.second) && res.month >= 1 &&
+           res.month <= 12 && res.day >= 1 && res.day <= 31 &&
+           res.hour < 24 && res.minute < 60 && res.second <= 60;
+}
+
+std::tm tm_of(const Civil& c) noexcept {
+    std::tm res{};
+    res.tm_year  = c.year - 1900;
+    res.tm_mon   = c.month - 1;
+    res.tm_mday  = c.day;
+    res.tm_hour  = c.hour;
+    res.tm_min   = c.minute;
+    res.tm_sec   = c.second;
+    res.tm_isdst = -1;
+    return res;
+}
+
+/// days since the epoch of a proleptic Gregorian date
+std::int64_t days_from_civil(int y, int m, int d) noexcept {
+    y -= m <= 2;
+    const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const auto         yoe = static_cast<unsigned>(y - era * 400);
+    const auto         doy = static_cast<unsigned>(
+        (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1);
+    const auto doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+/// seconds the local time is ahead of UTC at a local wall clock time
+std::int64_t utc_offset(std::int64_t local) {
+    std::tm      tm{};
+    const time_t t = local;
+    ::gmtime_r(&t, &tm);
+    tm.tm_isdst = -1;
+    return local - std::mktime(&tm);
+}
+
+/// the offsets of the local days are taken from mktime once per thread:
+/// a day keeps its offset unless a DST switch falls on it, the times of
+/// those days go to mktime one by one
+time_t local_time(const Civil& c) {
+    struct Day {
+        std::int64_t day;
+        std::int64_t offset;
+        bool         uniform;
+    };
+    thread_local auto days = [] {
+        std::array<Day, 16> res{};
+        for (auto& d : res) d.day = INT64_MIN;
+        return res;
+    }();
+
+    const auto day   = days_from_civil(c.year, c.month, c.day);
+    const auto local = day * 86400 + c.hour * 3600 + c.minute * 60 + c.second;
+    auto&      slot  = days[static_cast<std::uint64_t>(day) % days.size()];
+    if (slot.day != day) {
+        const auto first = utc_offset(day * 86400);
+        slot = {day, first, first == utc_offset(day * 86400 + 86399)};
+    }
+    if (!slot.uniform) {
+        auto tm = tm_of(c);
+        return std::mktime(&tm);
+    }
+    return static_cast<time_t>(local - slot.offset);
+}
+
+/// zero for a timestamp not in the format
+time_t parse_local_time(string_view text, bool month_name) {
+    Civil c{};
+    return parse_civil(text, month_name, c) ? local_time(c) : 0;
+}
+
+/// the strings of a view in one owned buffer: the values are appended as
+/// they come and the views point into it once it does not grow any more
+class Strings {
+    struct Span {
+        string_view*  view;
+        std::uint32_t begin;
+        std::uint32_t size;
+    };
+
+    string              _buffer;
+    std::array<Span, 8> _spans;
+    size_t              _count;
+
+   public:
+    Strings()               = default;
+    Strings(const Strings&) = delete;
+
+    void set(string_view& view, string_view value) {
+        auto* span =
+            std::find_if(_spans.begin(), _spans.begin() + _count,
+                         [&](const Span& s) { return s.view == &view; });
+        if (span == _spans.begin() + _count) {
+            if (_count == _spans.size()) return;
+            ++_count;
+        }
+        *span = {&view, static_cast<std::uint32_t>(_buffer.size()),
+                 static_cast<std::uint32_t>(value.size())};
+        _buffer.append(value);
+    }
+
+    void seal() noexcept {
+        for (size_t i{}; i < _count; ++i)
+            *_spans[i].view =
+                string_view{_buffer}.substr(_spans[i].begin, _spans[i].size);
+    }
+};
+
+/// the members a result must have, a bit per key is set as they come
+constexpr std::array<string_view, 9> SYSTEM_INFO_KEYS = {
+    "DeviceName"sv, "HwVersion"sv, "HttpApiVersion"sv,
+    "ICCID"sv,      "IMEI"sv,      "IMEISV"sv,
+    "IMSI"sv,       "BuildTime"sv, "MacAddress"sv};
+
+constexpr std::array<string_view, 10> SYSTEM_STATUS_KEYS = {
+    "NetworkName"sv,      "SignalStrength"sv,  "Conprofileerror"sv,
+    "ClearCode"sv,        "mPdpRejectCount"sv, "NetworkType"sv,
+    "ConnectionStatus"sv, "SmsState"sv,        "Roaming"sv,
+    "Domestic_Roaming"sv};
+
+constexpr std::array<string_view, 5> STORAGE_STATE_KEYS = {
+    "UnreadReport"sv, "LeftCount"sv, "MaxCount"sv, "TUseCount"sv,
+    "UnreadSMSCount"sv};
+
+constexpr std::array<string_view, 13> CONNECTION_STATE_KEYS = {
+    "ConnectionStatus"sv, "Conprofileerror"sv, "ClearCode"sv,
+    "mPdpRejectCount"sv,  "IPv4Adrress"sv,     "IPv6Adrress"sv,
+    "Speed_Dl"sv,         "Speed_Ul"sv,        "DlRate"sv,
+    "UlRate"sv,           "ConnectionTime"sv,  "UlBytes"sv,
+    "DlBytes"sv};
+
+template <size_t N>
+void mark(const std::array<string_view, N>& keys, string_view key,
+          std::uint32_t& seen) noexcept {
+    for (size_t i{}; i < N; ++i)
+        if (keys[i] == key) seen |= std::uint32_t{1} << i;
+}
+
+/// the first required key not seen, empty when there is none
+template <size_t N>
+string_view missing(const std::array<string_view, N>& keys,
+                    std::uint32_t seen) noexcept {
+    for (size_t i{}; i < N; ++i)
+        if (!(seen & std::uint32_t{1} << i)) return keys[i];
+    return {};
+}
+
+/// where the members of one result go
+struct Sink {
+    void* repr;
+    void (*field)(void*, string_view, const Scalar&);
+    void (*seal)(void*);
+    string_view (*missing)(const void*);
+};
+
+template <typename Repr>
+Sink sink_of(Repr& repr) {
+    return {&repr,
+            [](void* r, string_view key, const Scalar& value) {
+                static_cast<Repr*>(r)->field(key, value);
+            },
+            [](void* r) { static_cast<Repr*>(r)->seal(); },
+            [](const void* r) {
+                return static_cast<const Repr*>(r)->missing();
+            }};
+}
+
+void require(string_view key) {
+    if (!key.empty())
+        throw std::invalid_argument{
+            fmt::format("invalid server response: no {}", key)};
+}
+
+template <typename Repr>
+void fill(Repr& repr, const aux::json& j) {
+    for (const auto& [key, value] : j.items())
+        repr.field(key, scalar_of(value));
+    require(repr.missing());
+    repr.seal();
+}
+
+/// sax handler of json rpc responses: the scalar members of the results go
+/// to the sinks in order, the ids and errors are only checked, everything
+/// else is skipped
+class ResponseSax {
+    using json = aux::json;
+
+    enum Member : std::uint8_t { OTHER, ID, RESULT, ERROR };
+
+    const Sink*   _sinks;
+    size_t        _size;
+    std::uint32_t _first_id;
+
+    size_t               _depth;     // of the value being parsed
+    size_t               _envelope;  // depth of the responses, 2 in a batch
+    Member               _member;    // of the response being parsed
+    std::array<char, 32> _key;       // of the result member being parsed
+    size_t               _key_size;
+    bool                 _has_id;
+    bool                 _has_result;
+
+   public:
+    size_t      responses;
+    size_t      results;
+    bool        ids_match;
+    bool        failed;
+    int         error_code;
+    std::string error_message;
+
+    ResponseSax(const Sink* sinks, size_t size, std::uint32_t first_id)
+        : _sinks(sinks),
+          _size(size),
+          _first_id(first_id),
+          _depth{},
+          _envelope{1},
+          _member{},
+          _key{},
+          _key_size{},
+          _has_id{},
+          _has_result{},
+          responses{},
+          results{},
+          ids_match{true},
+          failed{},
+          error_code{} {}
+
+    bool null() { return value({}); }
+    bool boolean(bool val) { return value({val, {}}); }
+    bool number_integer(json::number_integer_t val) {
+        return value({val, {}});
+    }
+    bool number_unsigned(json::number_unsigned_t val) {
+        return value({static_cast<std::int64_t>(val), {}});
+    }
+    bool number_float(json::number_float_t val, const json::string_t&) {
+        return value({static_cast<std::int64_t>(val), {}});
+    }
+    bool string(json::string_t& val) {
+        Scalar res{0, val};
+        std::from_chars(val.data(), val.data() + val.size(), res.number);
+        return value(res);
+    }
+    bool binary(json::binary_t&) { return true; }
+
+    bool start_object(size_t) {
+        if (++_depth == _envelope) {
+            _member     = OTHER;
+            _has_id     = false;
+            _has_result = false;
+        } else if (_depth == _envelope + 1 && _member == ERROR) {
+            failed = true;
+        }
+        return true;
+    }
+
+    bool end_object() {
+        if (_depth-- != _envelope) return true;
+        if (!_has_id) ids_match = false;
+        if (_has_result) ++results;
+        if (responses < _size) _sinks[responses].seal(_sinks[responses].repr);
+        ++responses;
+        return true;
+    }
+
+    bool start_array(size_t) {
+        if (_depth == 0) _envelope = 2;
+        if (++_depth == _envelope + 1) _key_size = 0;  // a result of no keys
+        return true;
+    }
+
+    bool end_array() {
+        --_depth;
+        return true;
+    }
+
+    bool key(json::string_t& val) {
+        if (_depth == _envelope) {
+            _member = val == "id"       ? ID
+                      : val == "result" ? RESULT
+                      : val == "error"  ? ERROR
+                                        : OTHER;
+            if (_member == RESULT) _has_result = true;
+        } else if (_depth == _envelope + 1) {
+            // keys longer than the buffer are not in any result
+            _key_size = std::min(val.size(), _key.size());
+            std::memcpy(_key.data(), val.data(), _key_size);
+        }
+        return true;
+    }
+
+    bool parse_error(size_t, const std::string&,
+                     const nlohmann::detail::exception& ex) {
+        error_message = ex.what();
+        return false;
+    }
+
+   private:
+    bool value(const Scalar& val) {
+        if (_depth == _envelope && _member == ID) {
+            _has_id = true;
+            if (val.number != static_cast<std::int64_t>(_first_id + responses))
+                ids_match = false;
+        } else if (_depth == _envelope + 1) {
+            const string_view key{_key.data(), _key_size};
+            if (_member == RESULT && responses < _size)
+                _sinks[responses].field(_sinks[responses].repr, key, val);
+            else if (_member == ERROR && key == "code")
+                error_code = val.as<int>();
+            else if (_member == ERROR && key == "message")
+                error_message.assign(val.text);
+        }
+        return true;
+    }
+};
+}  // namespace
+
 namespace messages {
 
 class SystemInfo::_Repr {
     friend class SystemInfo;
     friend struct aux;
 
-    aux::json   _j_obj;
+    Strings     _strings;
     string_view _device_name;
     string_view _hw_version;
     string_view _http_api_version;
@@ -22,23 +432,40 @@ class SystemInfo::_Repr {
     mac_addr_t  _mac_addr;
     string_view _imeisv;
 
-    void refresh() {
-        _j_obj.at("DeviceName").get_to(_device_name);
-        _j_obj.at("HwVersion").get_to(_hw_version);
-        _j_obj.at("HttpApiVersion").get_to(_http_api_version);
-        _j_obj.at("ICCID").get_to(_iccid);
-        _j_obj.at("IMEI").get_to(_imei);
-        _j_obj.at("IMEISV").get_to(_imeisv);
-        _j_obj.at("IMSI").get_to(_imsi);
-        const auto& tmp = _j_obj.at("BuildTime").get_ref<const string&>();
-        std::istringstream{tmp} >>
-            std::get_time(&_build_time, "%Y-%m-%d %H:%M:%S");
-        const auto& str = _j_obj.at("MacAddress").get_ref<const string&>();
-        for (size_t j{}; j < 6; ++j)
-            _mac_addr[j] = std::stoul(str.substr(j * 3, 2), nullptr, 16);
-    }
-
-    _Repr(aux::json&& j) noexcept : _j_obj(std::move(j)) {}
+    std::uint32_t _seen;
+
+   public:
+    void field(string_view key, const Scalar& value) {
+        mark(SYSTEM_INFO_KEYS, key, _seen);
+        if (key == "DeviceName")
+            _strings.set(_device_name, value.text);
+        else if (key == "HwVersion")
+            _strings.set(_hw_version, value.text);
+        else if (key == "HttpApiVersion")
+            _strings.set(_http_api_version, value.text);
+        else if (key == "ICCID")
+            _strings.set(_iccid, value.text);
+        else if (key == "IMEI")
+            _strings.set(_imei, value.text);
+        else if (key == "IMEISV")
+            _strings.set(_imeisv, value.text);
+        else if (key == "IMSI")
+            _strings.set(_imsi, value.text);
+        else if (Civil c{}; key == "BuildTime" &&
+                                parse_civil(value.text, false, c))
+            _build_time = tm_of(c);
+        else if (key == "MacAddress")
+            for (size_t j{}; j < 6 && j * 3 + 2 <= value.text.size(); ++j)
+                std::from_chars(value.text.data() + j * 3,
+                                value.text.data() + j * 3 + 2, _mac_addr[j],
+                                16);
+    }
+
+    string_view missing() const noexcept {
+        return ::missing(SYSTEM_INFO_KEYS, _seen);
+    }
+
+    void seal() noexcept { _strings.seal(); }
 };
 
 const char* aux::query_str_(query_str_tag<SystemInfo>) noexcept {
@@ -46,12 +473,8 @@ const char* aux::query_str_(query_str_tag<SystemInfo>) noexcept {
 }
 
 SystemInfo& aux::emplace_json(SystemInfo& i, json&& j) {
-    if (i._repr)
-        i._repr->_j_obj = std::move(j);
-    else
-        i._repr = std::unique_ptr<SystemInfo::_Repr>(
-            new SystemInfo::_Repr(std::move(j)));
-    i._repr->refresh();
+    i._repr = std::make_unique<SystemInfo::_Repr>();
+    fill(*i._repr, j);
     return i;
 }
 
@@ -152,7 +575,7 @@ class SystemStatus::_Repr {
     friend class SystemStatus;
     friend struct aux;
 
-    aux::json        _j_obj;
+    Strings          _strings;
     string_view      _network_name;
     int              _signal_strength;
     int              _conprof_error;
@@ -163,24 +586,38 @@ class SystemStatus::_Repr {
     SmsState         _sms_state;
     bool             _roaming;
     bool             _domestic_roaming;
+    std::uint32_t    _seen;
+
+   public:
+    void field(string_view key, const Scalar& value) {
+        mark(SYSTEM_STATUS_KEYS, key, _seen);
+        if (key == "NetworkName")
+            _strings.set(_network_name, value.text);
+        else if (key == "SignalStrength")
+            _signal_strength = value.as<int>();
+        else if (key == "Conprofileerror")
+            _conprof_error = value.as<int>();
+        else if (key == "ClearCode")
+            _clear_code = value.as<int>();
+        else if (key == "mPdpRejectCount")
+            _m_pdp_reject_count = value.as<int>();
+        else if (key == "NetworkType")
+            _network_type = value.as<NetworkType>();
+        else if (key == "ConnectionStatus")
+            _connection_status = value.as<ConnectionStatus>();
+        else if (key == "SmsState")
+            _sms_state = value.as<SmsState>();
+        else if (key == "Roaming")
+            _roaming = value.number > 0;
+        else if (key == "Domestic_Roaming")
+            _domestic_roaming = value.number > 0;
+    }
+
+    string_view missing() const noexcept {
+        return ::missing(SYSTEM_STATUS_KEYS, _seen);
+    }
 
-    void refresh() {
-        _j_obj.at("NetworkName").get_to(_network_name);
-        _j_obj.at("SignalStrength").get_to(_signal_strength);
-        _j_obj.at("Conprofileerror").get_to(_conprof_error);
-        _j_obj.at("ClearCode").get_to(_clear_code);
-        _j_obj.at("mPdpRejectCount").get_to(_m_pdp_reject_count);
-        _j_obj.at("NetworkType").get_to(_network_type);
-        _j_obj.at("ConnectionStatus").get_to(_connection_status);
-        _j_obj.at("SmsState").get_to(_sms_state);
-        int tmp;
-        _j_obj.at("Roaming").get_to(tmp);
-        _roaming = tmp > 0;
-        _j_obj.at("Domestic_Roaming").get_to(tmp);
-        _domestic_roaming = tmp > 0;
-    }
-
-    _Repr(aux::json&& j) noexcept : _j_obj(std::move(j)) {}
+    void seal() noexcept { _strings.seal(); }
 };
 
 const char* aux::query_str_(query_str_tag<SystemStatus>) noexcept {
@@ -188,12 +625,8 @@ const char* aux::query_str_(query_str_tag<SystemStatus>) noexcept {
 }
 
 SystemStatus& aux::emplace_json(SystemStatus& s, json&& j) {
-    if (s._repr)
-        s._repr->_j_obj = std::move(j);
-    else
-        s._repr = std::unique_ptr<SystemStatus::_Repr>(
-            new SystemStatus::_Repr(std::move(j)));
-    s._repr->refresh();
+    s._repr = std::make_unique<SystemStatus::_Repr>();
+    fill(*s._repr, j);
     return s;
 }
 
@@ -250,6 +683,29 @@ class SmsStorageState::_Repr {
     int max_count;
     int use_count;
     int unread_count;
+
+    std::uint32_t _seen;
+
+   public:
+    void field(string_view key, const Scalar& value) {
+        mark(STORAGE_STATE_KEYS, key, _seen);
+        if (key == "UnreadReport")
+            unread_report = value.as<int>();
+        else if (key == "LeftCount")
+            left_count = value.as<int>();
+        else if (key == "MaxCount")
+            max_count = value.as<int>();
+        else if (key == "TUseCount")
+            use_count = value.as<int>();
+        else if (key == "UnreadSMSCount")
+            unread_count = value.as<int>();
+    }
+
+    string_view missing() const noexcept {
+        return ::missing(STORAGE_STATE_KEYS, _seen);
+    }
+
+    void seal() noexcept {}
 };
 
 const char* aux::query_str_(query_str_tag<SmsStorageState>) noexcept {
@@ -257,12 +713,8 @@ const char* aux::query_str_(query_str_tag<SmsStorageState>) noexcept {
 }
 
 SmsStorageState& aux::from_json(const json& j, SmsStorageState& ss) {
-    if (!ss._repr) ss._repr = std::make_unique<SmsStorageState::_Repr>();
-    j.at("UnreadReport").get_to(ss._repr->unread_count);
-    j.at("LeftCount").get_to(ss._repr->left_count);
-    j.at("MaxCount").get_to(ss._repr->max_count);
-    j.at("TUseCount").get_to(ss._repr->use_count);
-    j.at("UnreadSMSCount").get_to(ss._repr->unread_count);
+    ss._repr = std::make_unique<SmsStorageState::_Repr>();
+    fill(*ss._repr, j);
     return ss;
 }
 
@@ -293,7 +745,7 @@ class ConnectionState::_Repr {
     friend class ConnectionState;
     friend struct aux;
 
-    aux::json        _j_obj;
+    Strings          _strings;
     ConnectionStatus connection_status;
     int              conprof_error;
     int              clear_code;
@@ -307,26 +759,44 @@ class ConnectionState::_Repr {
     size_t           dl_bytes;
     size_t           ul_bytes;
     seconds          connection_time;
+    std::uint32_t    _seen;
+
+   public:
+    void field(string_view key, const Scalar& value) {
+        mark(CONNECTION_STATE_KEYS, key, _seen);
+        if (key == "ConnectionStatus")
+            connection_status = value.as<ConnectionStatus>();
+        else if (key == "Conprofileerror")
+            conprof_error = value.as<int>();
+        else if (key == "ClearCode")
+            clear_code = value.as<int>();
+        else if (key == "mPdpRejectCount")
+            m_pdp_reject_count = value.as<int>();
+        else if (key == "IPv4Adrress")
+            _strings.set(ipv4_address, value.text);
+        else if (key == "IPv6Adrress")
+            _strings.set(ipv6_address, value.text);
+        else if (key == "Speed_Dl")
+            dl_speed = value.as<size_t>();
+        else if (key == "Speed_Ul")
+            ul_speed = value.as<size_t>();
+        else if (key == "DlRate")
+            dl_rate = value.as<size_t>();
+        else if (key == "UlRate")
+            ul_rate = value.as<size_t>();
+        else if (key == "ConnectionTime")
+            connection_time = seconds(value.number);
+        else if (key == "UlBytes")
+            ul_bytes = value.as<size_t>();
+        else if (key == "DlBytes")
+            dl_bytes = value.as<size_t>();
+    }
 
-    _Repr(aux::json&& j) noexcept : _j_obj(std::move(j)) {}
-
-    void refresh() {
-        _j_obj.at("ConnectionStatus").get_to(connection_status);
-        _j_obj.at("Conprofileerror").get_to(conprof_error);
-        _j_obj.at("ClearCode").get_to(clear_code);
-        _j_obj.at("mPdpRejectCount").get_to(m_pdp_reject_count);
-        _j_obj.at("IPv4Adrress").get_to(ipv4_address);
-        _j_obj.at("IPv6Adrress").get_to(ipv6_address);
-        _j_obj.at("Speed_Dl").get_to(dl_speed);
-        _j_obj.at("Speed_Ul").get_to(ul_speed);
-        _j_obj.at("DlRate").get_to(dl_rate);
-        _j_obj.at("UlRate").get_to(ul_rate);
-        size_t ctime{};
-        _j_obj.at("ConnectionTime").get_to(ctime);
-        connection_time = seconds(ctime);
-        _j_obj.at("UlBytes").get_to(ul_bytes);
-        _j_obj.at("DlBytes").get_to(dl_bytes);
+    string_view missing() const noexcept {
+        return ::missing(CONNECTION_STATE_KEYS, _seen);
     }
+
+    void seal() noexcept { _strings.seal(); }
 };
 
 const char* aux::query_str_(query_str_tag<ConnectionState>) noexcept {
@@ -334,15 +804,41 @@ const char* aux::query_str_(query_str_tag<ConnectionState>) noexcept {
 }
 
 ConnectionState& aux::emplace_json(ConnectionState& s, json&& j) {
-    if (s._repr)
-        s._repr->_j_obj = std::move(j);
-    else
-        s._repr = std::unique_ptr<ConnectionState::_Repr>(
-            new ConnectionState::_Repr(std::move(j)));
-    s._repr->refresh();
+    s._repr = std::make_unique<ConnectionState::_Repr>();
+    fill(*s._repr, j);
     return s;
 }
 
+bool aux::decode(string_view body, std::uint32_t first_id,
+                 std::initializer_list<view_ptr> views) {
+    std::array<Sink, 4> sinks{};
+    if (views.size() > sinks.size())
+        throw std::invalid_argument{"too many views in one response"};
+
+    size_t count{};
+    for (const auto& view : views)
+        sinks[count++] = std::visit(
+            [](auto* v) {
+                using Repr = typename std::remove_pointer_t<decltype(v)>::_Repr;
+                v->_repr   = std::make_unique<Repr>();
+                return sink_of(*v->_repr);
+            },
+            view);
+
+    ResponseSax sax{sinks.data(), count, first_id};
+    if (!json::sax_parse(body, &sax))
+        throw std::invalid_argument{fmt::format(
+            "invalid server response: {}", sax.error_message)};
+    // firmwares without batch support answer a batch with one error
+    if (sax.responses != count) return false;
+    if (sax.failed) throw rpc_error{sax.error_code, sax.error_message};
+    if (!sax.ids_match) return false;
+    if (sax.results != count)
+        throw std::invalid_argument{"invalid server response: no result"};
+    for (size_t i{}; i < count; ++i) require(sinks[i].missing(sinks[i].repr));
+    return true;
+}
+
 ConnectionState::ConnectionState()                           = default;
 ConnectionState::ConnectionState(ConnectionState&&) noexcept = default;
 ConnectionState& ConnectionState::operator=(ConnectionState&&) noexcept =
@@ -429,17 +925,10 @@ void from_json(const aux::json& j, SmsContent& smsc) {
     j.at("report_id").get_to(smsc.report_id);
     j.at("SMSContent").get_to(smsc.sms_content);
 
-    string tmp{};
-    j.at("SMSTime").get_to(tmp);
-    std::tm tm{};
-    std::stringstream{std::move(tmp)} >>
-        std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
-    smsc.sms_time = std::mktime(&tm);
-
-    j.at("report_time").get_to(tmp);
-    std::stringstream{std::move(tmp)} >>
-        std::get_time(&tm, "%Y-%b-%d %H:%M:%S");
-    smsc.report_time = std::mktime(&tm);
+    smsc.sms_time = parse_local_time(
+        j.at("SMSTime").get_ref<const string&>(), false);
+    smsc.report_time = parse_local_time(
+        j.at("report_time").get_ref<const string&>(), true);
 
     j.at("SMSTimezone").get_to(smsc.time_zone);
 }
@@ -496,11 +985,12 @@ void from_json(const aux::json& j, SendSmsResult& res) {
 }
 
 aux::named_parameter aux::as_param(SendSms&& sms) {
+    std::tm tm{};
+    ::localtime_r(&sms.sms_time, &tm);
     return {{"SMSId", sms.sms_id},
             {"SMSContent", std::move(sms.sms_content)},
             {"PhoneNumber", std::move(sms.phone_numbers)},
-            {"SMSTime", fmt::format("{:%Y-%m-%d %H:%M:%S}",
-                                    *std::localtime(&sms.sms_time))}};
+            {"SMSTime", fmt::format("{:%Y-%m-%d %H:%M:%S}", tm)}};
 }
 
 SendSms::SendSms(vector<string> nums, string content)
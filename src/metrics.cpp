@@ -0,0 +1,220 @@
+#ifndef CPPHTTPLIB_ALLOW_LF_AS_LINE_TERMINATOR
+#define CPPHTTPLIB_ALLOW_LF_AS_LINE_TERMINATOR
+#endif
+
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "fmt/core.h"
+#include "fmt/format.h"
+#include "httplib.h"
+
+namespace {
+using metrics::Histogram;
+
+// threads take their shard in turn, more threads than shards share them
+size_t shard_index() noexcept {
+    static std::atomic<size_t> next{};
+    thread_local const size_t  index =
+        next.fetch_add(1, std::memory_order_relaxed) % Histogram::SHARDS;
+    return index;
+}
+
+std::string escape(std::string_view value) {
+    std::string res{};
+    res.reserve(value.size());
+    for (const auto c : value) {
+        if (c == '\\' || c == '"')
+            res += '\\', res += c;
+        else if (c == '\n')
+            res += "\\n";
+        else
+            res += c;
+    }
+    return res;
+}
+
+std::string label_text(metrics::Registry::Labels labels) {
+    std::string res{};
+    for (const auto& [key, value] : labels) {
+        if (!res.empty()) res += ',';
+        res += fmt::format("{}=\"{}\"", key, escape(value));
+    }
+    return res;
+}
+
+std::string braced(const std::string& labels, std::string_view extra = {}) {
+    if (labels.empty() && extra.empty()) return {};
+    if (labels.empty()) return fmt::format("{{{}}}", extra);
+    if (extra.empty()) return fmt::format("{{{}}}", labels);
+    return fmt::format("{{{},{}}}", labels, extra);
+}
+}  // namespace
+
+namespace metrics {
+
+void Histogram::observe(double seconds) noexcept {
+    auto&      shard  = _shards[shard_index()];
+    const auto bucket = static_cast<size_t>(
+        std::lower_bound(BOUNDS.begin(), BOUNDS.end(), seconds) -
+        BOUNDS.begin());
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum_ns.fetch_add(
+        static_cast<std::uint64_t>(std::max(seconds, 0.0) * 1e9),
+        std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::collect() const noexcept {
+    Snapshot      snap{};
+    std::uint64_t sum_ns{};
+    for (const auto& shard : _shards) {
+        for (size_t b{}; b < snap.buckets.size(); ++b) {
+            const auto n = shard.buckets[b].load(std::memory_order_relaxed);
+            snap.buckets[b] += n;
+            snap.count += n;
+        }
+        sum_ns += shard.sum_ns.load(std::memory_order_relaxed);
+    }
+    snap.sum = static_cast<double>(sum_ns) / 1e9;
+    return snap;
+}
+
+struct Registry::_Impl {
+    struct Family {
+        Type                                         type;
+        string                                       help;
+        std::map<string, std::unique_ptr<Counter>>   counters;
+        std::map<string, std::unique_ptr<Gauge>>     gauges;
+        std::map<string, std::unique_ptr<Histogram>> histograms;
+        std::map<string, Sample>                     samples;
+    };
+
+    std::mutex                            _mutex;
+    std::map<string, Family, std::less<>> _families;
+
+    Family& family(string_view name, string_view help, Type type) {
+        auto it = _families.find(name);
+        if (it == _families.end())
+            it = _families
+                     .emplace(string{name},
+                              Family{type, string{help}, {}, {}, {}, {}})
+                     .first;
+        if (it->second.type != type)
+            throw std::logic_error{
+                fmt::format("metric {} is registered with other type", name)};
+        return it->second;
+    }
+
+    template <typename T>
+    static T& get(std::map<string, std::unique_ptr<T>>& metrics,
+                  Labels                                 labels) {
+        auto& metric = metrics[label_text(labels)];
+        if (!metric) metric = std::make_unique<T>();
+        return *metric;
+    }
+
+    static void render(string& out, const string& name, const Family& f);
+};
+
+void Registry::_Impl::render(string& out, const string& name,
+                             const Family& f) {
+    constexpr std::string_view TYPES[] = {"counter", "gauge", "histogram"};
+    out += fmt::format("# HELP {} {}\n# TYPE {} {}\n", name, f.help, name,
+                       TYPES[static_cast<size_t>(f.type)]);
+
+    for (const auto& [labels, counter] : f.counters)
+        out += fmt::format("{}{} {}\n", name, braced(labels), counter->value());
+    for (const auto& [labels, gauge] : f.gauges)
+        out += fmt::format("{}{} {}\n", name, braced(labels), gauge->value());
+    for (const auto& [labels, sample] : f.samples)
+        out += fmt::format("{}{} {}\n", name, braced(labels), sample());
+
+    for (const auto& [labels, histogram] : f.histograms) {
+        const auto    snap = histogram->collect();
+        std::uint64_t cumulative{};
+        for (size_t b{}; b < snap.buckets.size(); ++b) {
+            cumulative += snap.buckets[b];
+            const auto le = b < Histogram::BOUNDS.size()
+                                ? fmt::format("le=\"{}\"",
+                                              Histogram::BOUNDS[b])
+                                : string{"le=\"+Inf\""};
+            out += fmt::format("{}_bucket{} {}\n", name, braced(labels, le),
+                               cumulative);
+        }
+        out += fmt::format("{}_sum{} {}\n{}_count{} {}\n", name,
+                           braced(labels), snap.sum, name, braced(labels),
+                           snap.count);
+    }
+}
+
+Registry::Registry() : _impl(std::make_unique<_Impl>()) {}
+
+Registry::~Registry() = default;
+
+Counter& Registry::counter(string_view name, string_view help, Labels labels) {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    return _Impl::get(_impl->family(name, help, Type::COUNTER).counters,
+                      labels);
+}
+
+Gauge& Registry::gauge(string_view name, string_view help, Labels labels) {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    return _Impl::get(_impl->family(name, help, Type::GAUGE).gauges, labels);
+}
+
+Histogram& Registry::histogram(string_view name, string_view help,
+                               Labels labels) {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    return _Impl::get(_impl->family(name, help, Type::HISTOGRAM).histograms,
+                      labels);
+}
+
+void Registry::sample(Type type, string_view name, string_view help,
+                      Labels labels, Sample sample) {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    _impl->family(name, help, type).samples[label_text(labels)] =
+        std::move(sample);
+}
+
+string Registry::render() {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    string out{};
+    for (const auto& [name, family] : _impl->_families)
+        _Impl::render(out, name, family);
+    return out;
+}
+
+Registry& registry() {
+    static Registry instance{};
+    return instance;
+}
+
+struct Server::_Impl {
+    httplib::Server _server;
+    std::thread     _thread;
+};
+
+Server::Server(Registry& registry, const string& host, int port)
+    : _impl(std::make_unique<_Impl>()) {
+    _impl->_server.Get("/metrics", [&registry](const httplib::Request&,
+                                                httplib::Response& res) {
+        res.set_content(registry.render(), "text/plain; version=0.0.4");
+    });
+    if (!_impl->_server.bind_to_port(host.c_str(), port))
+        throw std::runtime_error{
+            fmt::format("unable to listen on {}:{}", host, port)};
+    _impl->_thread =
+        std::thread([this]() { _impl->_server.listen_after_bind(); });
+}
+
+Server::~Server() {
+    _impl->_server.stop();
+    if (_impl->_thread.joinable()) _impl->_thread.join();
+}
+
+}  // namespace metrics
@@ -0,0 +1,284 @@
+#include "reactor.hpp"
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <map>
+#include <mutex>
+#include <system_error>
+
+#include "spdlog/spdlog.h"
+
+namespace {
+std::system_error errno_error(const char* what) {
+    return std::system_error{errno, std::generic_category(), what};
+}
+
+sigset_t signal_set(std::initializer_list<int> signals) {
+    sigset_t set{};
+    ::sigemptyset(&set);
+    for (const auto signo : signals) ::sigaddset(&set, signo);
+    return set;
+}
+
+// reads the whole counter of a timerfd or an eventfd
+void drain(int fd) {
+    std::uint64_t count{};
+    while (::read(fd, &count, sizeof count) < 0 && errno == EINTR) {
+    }
+}
+
+constexpr std::uint32_t FILE_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO;
+constexpr std::uint32_t DIR_EVENTS  = IN_CREATE | IN_MOVED_TO | IN_ONLYDIR;
+}  // namespace
+
+namespace spool {
+
+struct Reactor::_Impl {
+    int                     _epoll;
+    int                     _wakeup;  // eventfd written by stop()
+    int                     _posted;  // eventfd written by post()
+    vector<int>             _owned;   // timers and signal fds
+    std::map<int, Handler>  _handlers;
+    std::mutex              _mutex;   // of the posted tasks
+    vector<Tick>            _tasks;
+    bool                    _stopped;
+
+    _Impl()
+        : _epoll(::epoll_create1(EPOLL_CLOEXEC)),
+          _wakeup(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+          _posted(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+          _stopped{} {
+        if (_epoll < 0) throw errno_error("epoll create");
+        if (_wakeup < 0 || _posted < 0) throw errno_error("eventfd create");
+        add(_wakeup, EPOLLIN, [this](std::uint32_t) {
+            drain(_wakeup);
+            _stopped = true;
+        });
+        add(_posted, EPOLLIN, [this](std::uint32_t) {
+            drain(_posted);
+            vector<Tick> tasks{};
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                tasks.swap(_tasks);
+            }
+            for (const auto& task : tasks) task();
+        });
+    }
+
+    ~_Impl() {
+        for (const auto fd : _owned) ::close(fd);
+        ::close(_posted);
+        ::close(_wakeup);
+        ::close(_epoll);
+    }
+
+    void add(int fd, std::uint32_t events, Handler handler) {
+        epoll_event ev{};
+        ev.events  = events;
+        ev.data.fd = fd;
+        if (::epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev) != 0)
+            throw errno_error("epoll add");
+        _handlers[fd] = std::move(handler);
+    }
+};
+
+void Reactor::block(std::initializer_list<int> signals) {
+    const auto set = signal_set(signals);
+    if (const auto err = ::pthread_sigmask(SIG_BLOCK, &set, nullptr))
+        throw std::system_error{err, std::generic_category(), "signal mask"};
+}
+
+Reactor::Reactor() : _impl(std::make_unique<_Impl>()) {}
+
+Reactor::Reactor(Reactor&&) noexcept = default;
+
+Reactor::~Reactor() = default;
+
+void Reactor::watch(int fd, std::uint32_t events, Handler handler) {
+    _impl->add(fd, events, std::move(handler));
+}
+
+void Reactor::unwatch(int fd) {
+    ::epoll_ctl(_impl->_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    _impl->_handlers.erase(fd);
+}
+
+void Reactor::every(milliseconds interval, Tick tick) {
+    const auto fd = ::timerfd_create(CLOCK_MONOTONIC,
+                                     TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) throw errno_error("timerfd create");
+    _impl->_owned.push_back(fd);
+
+    const auto ms = interval.count() > 0 ? interval.count() : 1;
+    itimerspec spec{};
+    spec.it_interval.tv_sec  = ms / 1000;
+    spec.it_interval.tv_nsec = (ms % 1000) * 1'000'000;
+    spec.it_value            = spec.it_interval;
+    if (::timerfd_settime(fd, 0, &spec, nullptr) != 0)
+        throw errno_error("timerfd set");
+
+    // missed expirations are not caught up, one tick is enough
+    _impl->add(fd, EPOLLIN, [fd, tick = std::move(tick)](std::uint32_t) {
+        drain(fd);
+        tick();
+    });
+}
+
+void Reactor::on_signals(std::initializer_list<int> signals,
+                         SignalHandler handler) {
+    const auto set = signal_set(signals);
+    const auto fd  = ::signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0) throw errno_error("signalfd create");
+    _impl->_owned.push_back(fd);
+
+    _impl->add(fd, EPOLLIN,
+               [fd, handler = std::move(handler)](std::uint32_t) {
+                   signalfd_siginfo info{};
+                   while (::read(fd, &info, sizeof info) ==
+                          static_cast<ssize_t>(sizeof info))
+                       handler(static_cast<int>(info.ssi_signo));
+               });
+}
+
+void Reactor::post(Tick task) {
+    {
+        std::lock_guard<std::mutex> lock(_impl->_mutex);
+        _impl->_tasks.push_back(std::move(task));
+    }
+    const std::uint64_t one{1};
+    while (::write(_impl->_posted, &one, sizeof one) < 0 && errno == EINTR) {
+    }
+}
+
+void Reactor::run() {
+    std::array<epoll_event, 16> events{};
+    _impl->_stopped = false;
+    while (!_impl->_stopped) {
+        const auto n = ::epoll_wait(_impl->_epoll, events.data(),
+                                    static_cast<int>(events.size()), -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw errno_error("epoll wait");
+        }
+        for (int i{}; i < n && !_impl->_stopped; ++i) {
+            // a handler may unwatch any descriptor, its own as well
+            const auto it = _impl->_handlers.find(events[i].data.fd);
+            if (it == _impl->_handlers.end()) continue;
+            const auto handler = it->second;
+            handler(events[i].events);
+        }
+    }
+}
+
+void Reactor::stop() {
+    const std::uint64_t one{1};
+    while (::write(_impl->_wakeup, &one, sizeof one) < 0 && errno == EINTR) {
+    }
+}
+
+struct DirectoryWatch::_Impl {
+    fs::path                _dir;
+    int                     _fd;
+    std::map<int, fs::path> _watches;  // by watch descriptor
+
+    explicit _Impl(const fs::path& dir)
+        : _dir(dir), _fd(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+        if (_fd < 0) throw errno_error("inotify init");
+    }
+
+    ~_Impl() { ::close(_fd); }
+
+    void add(const fs::path& dir) {
+        const auto wd =
+            ::inotify_add_watch(_fd, dir.c_str(), FILE_EVENTS | DIR_EVENTS);
+        if (wd < 0) throw errno_error("inotify add watch");
+        _watches[wd] = dir;
+    }
+
+    void add_recursively(const fs::path& dir) {
+        add(dir);
+        for (const auto& entry : fs::recursive_directory_iterator{dir})
+            if (entry.is_directory()) add(entry.path());
+    }
+
+    /// a directory created or moved in is watched with its sub directories,
+    /// the files already in them are reported, they came before the watch;
+    /// it may be gone again by now, that is not an error of the watch
+    void add_new(const fs::path& dir, vector<fs::path>& files) {
+        try {
+            add(dir);
+            for (const auto& entry : fs::recursive_directory_iterator{dir})
+                if (entry.is_directory())
+                    add(entry.path());
+                else if (entry.is_regular_file())
+                    files.push_back(entry.path());
+        } catch (const std::exception& e) {
+            spdlog::warn("unable to watch directory {}: {}", dir.string(),
+                         e.what());
+        }
+    }
+};
+
+DirectoryWatch::DirectoryWatch(const fs::path& dir)
+    : _impl(std::make_unique<_Impl>(dir)) {
+    _impl->add_recursively(dir);
+}
+
+DirectoryWatch::DirectoryWatch(DirectoryWatch&&) noexcept = default;
+
+DirectoryWatch::~DirectoryWatch() = default;
+
+int DirectoryWatch::fd() const noexcept { return _impl->_fd; }
+
+vector<fs::path> DirectoryWatch::read() {
+    vector<fs::path> files{};
+    alignas(inotify_event) std::array<char, 4096> buf{};
+
+    for (;;) {
+        const auto n = ::read(_impl->_fd, buf.data(), buf.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) break;
+            throw errno_error("inotify read");
+        }
+        for (ssize_t i{}; i < n;) {
+            const auto* ev = reinterpret_cast<const inotify_event*>(&buf[i]);
+            i += static_cast<ssize_t>(sizeof(inotify_event) + ev->len);
+
+            if (ev->mask & IN_IGNORED) {
+                _impl->_watches.erase(ev->wd);
+                continue;
+            }
+            const auto it = _impl->_watches.find(ev->wd);
+            if (it == _impl->_watches.end() || ev->len == 0) continue;
+
+            const auto path = it->second / ev->name;
+            if (ev->mask & IN_ISDIR)
+                _impl->add_new(path, files);
+            else if (ev->mask & FILE_EVENTS)
+                files.push_back(path);
+        }
+    }
+    return files;
+}
+
+void DirectoryWatch::pause() {
+    for (const auto& [wd, dir] : _impl->_watches)
+        ::inotify_rm_watch(_impl->_fd, wd);
+    _impl->_watches.clear();
+}
+
+void DirectoryWatch::resume() {
+    if (_impl->_watches.empty()) _impl->add_recursively(_impl->_dir);
+}
+
+}  // namespace spool
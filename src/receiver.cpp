@@ -0,0 +1,133 @@
+#include "receiver.hpp"
+
+#include <fstream>
+#include <map>
+#include <set>
+
+#include "fmt/chrono.h"
+#include "fmt/core.h"
+#include "spool_file.hpp"
+
+namespace {
+using messages::Device;
+using messages::SmsContent;
+using messages::SmsContentList;
+using messages::SystemStatus;
+using std::chrono::steady_clock;
+
+// ids kept of a modem, more than the storage of a dongle takes
+constexpr size_t KEPT_IDS = 1024;
+
+bool is_received(SmsContent::SmsType type) noexcept {
+    return type == SmsContent::READ || type == SmsContent::UNREAD ||
+           type == SmsContent::FLASH;
+}
+}  // namespace
+
+namespace spool {
+
+struct Receiver::_Impl {
+    fs::path _incoming;
+    fs::path _state;
+    seconds  _fresh;
+
+    /// ids of the written SMSes by modem
+    std::map<string, std::set<int>> _written;
+
+    _Impl(fs::path incoming, fs::path state, seconds fresh)
+        : _incoming(std::move(incoming)),
+          _state(std::move(state)),
+          _fresh(fresh) {
+        load();
+    }
+
+    /// lines of "modem id"
+    void load() {
+        if (_state.empty()) return;
+        std::ifstream in{_state};
+        string        modem{};
+        int           id{};
+        while (in >> modem >> id) _written[modem].insert(id);
+    }
+
+    void save() {
+        if (_state.empty()) return;
+        string text{};
+        for (const auto& [modem, ids] : _written)
+            for (const auto id : ids) text += fmt::format("{} {}\n", modem, id);
+        const auto dir = _state.parent_path();
+        write_spool_file(dir.empty() ? "." : dir, _state.filename().string(),
+                         text);
+    }
+
+    /// unread, or read by someone else since the last one written; read
+    /// ones are not taken before the first write, they were there before
+    static bool is_new(const std::set<int>& written, const SmsContent& sms) {
+        if (!is_received(sms.sms_type) || written.contains(sms.sms_id))
+            return false;
+        return sms.sms_type != SmsContent::READ ||
+               (!written.empty() && sms.sms_id > *written.rbegin());
+    }
+
+    void write(const string& modem, const SmsContentList& list,
+               const SmsContent& sms) {
+        const auto name = fmt::format("{}.{:%Y%m%d-%H%M%S}.{}", modem,
+                                      sms.sms_time_ltm(), sms.sms_id);
+        write_spool_file(
+            _incoming, name,
+            format_incoming_file(
+                {list.phone_numbers.empty() ? "" : list.phone_numbers.front(),
+                 sms.sms_time, std::time(nullptr), modem, sms.sms_content}));
+    }
+};
+
+Receiver::Receiver(fs::path incoming, fs::path state, seconds fresh)
+    : _impl(std::make_unique<_Impl>(std::move(incoming), std::move(state),
+                                     fresh)) {}
+
+Receiver::Receiver(Receiver&&) noexcept = default;
+
+Receiver::~Receiver() = default;
+
+size_t Receiver::poll(Device& device, const string& modem) {
+    auto state = device.state();
+    if (!state->system_status || !state->sms_storage_state ||
+        steady_clock::now() - state->updated > _impl->_fresh)
+        state = device.snapshot();
+    if (!state->system_status || !state->sms_storage_state) return 0;
+
+    const auto unread = state->sms_storage_state->unread_count();
+    if (unread <= 0 &&
+        state->system_status->sms_state() != SystemStatus::SmsState::NEW)
+        return 0;
+
+    auto&  written = _impl->_written[modem];
+    size_t count{};
+    int    found{};
+    try {
+        for (const auto& contacts : device.all_sms_contacts()) {
+            for (const auto& contact : contacts.contacts) {
+                if (contact.unread_count == 0) continue;
+                found += static_cast<int>(contact.unread_count);
+                for (const auto& list :
+                     device.all_sms_contents(contact.contact_id))
+                    for (const auto& sms : list.contents) {
+                        if (!_Impl::is_new(written, sms)) continue;
+                        _impl->write(modem, list, sms);
+                        written.insert(sms.sms_id);
+                        ++count;
+                    }
+            }
+            // the rest of the contacts have nothing unread
+            if (unread > 0 && found >= unread) break;
+        }
+    } catch (...) {
+        // the files written before the error are not written again
+        if (count > 0) _impl->save();
+        throw;
+    }
+    while (written.size() > KEPT_IDS) written.erase(written.begin());
+    if (count > 0) _impl->save();
+    return count;
+}
+}  // namespace spool
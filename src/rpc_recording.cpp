@@ -0,0 +1,202 @@
+#include "rpc_recording.hpp"
+
+#include <charconv>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "fmt/core.h"
+#include "jsonrpccxx/common.hpp"
+#include "nlohmann/json.hpp"
+
+namespace {
+using namespace std::string_view_literals;
+
+using std::chrono::steady_clock;
+using json = nlohmann::json;
+
+struct Exchange {
+    std::chrono::microseconds at;
+    std::chrono::microseconds took;
+    int                       status;
+    std::string               host;
+    std::string               request;
+    std::string               response;
+    bool                      served;
+};
+
+// the next space separated field of the header line
+template <typename T>
+bool field(std::string_view& line, T& value) {
+    const auto end = line.find(' ');
+    const auto str = line.substr(0, end);
+    if constexpr (std::is_same_v<T, std::string>)
+        value.assign(str);
+    else if (std::from_chars(str.data(), str.data() + str.size(), value).ec !=
+             std::errc{})
+        return false;
+    line.remove_prefix(end == std::string_view::npos ? line.size() : end + 1);
+    return !str.empty();
+}
+
+std::vector<Exchange> load(const staff::fs::path& file) {
+    std::ifstream in{file, std::ios::binary};
+    if (!in)
+        throw std::system_error{errno, std::generic_category(),
+                                "rpc recording open"};
+    const std::string text{std::istreambuf_iterator<char>{in}, {}};
+
+    std::vector<Exchange> res{};
+    std::string_view      rest{text};
+    while (!rest.empty()) {
+        const auto eol = rest.find('\n');
+        if (eol == std::string_view::npos) break;
+        auto line = rest.substr(0, eol);
+        rest.remove_prefix(eol + 1);
+
+        Exchange ex{};
+        long     at{}, took{};
+        size_t   req_size{}, res_size{};
+        if (!field(line, at) || !field(line, took) || !field(line, ex.status) ||
+            !field(line, ex.host) || !field(line, req_size) ||
+            !field(line, res_size) || rest.size() < req_size + res_size + 1)
+            throw std::runtime_error{
+                fmt::format("broken rpc recording after {} exchanges",
+                            res.size())};
+        ex.at   = std::chrono::microseconds{at};
+        ex.took = std::chrono::microseconds{took};
+        ex.request.assign(rest.substr(0, req_size));
+        ex.response.assign(rest.substr(req_size, res_size));
+        rest.remove_prefix(req_size + res_size + 1);
+        res.push_back(std::move(ex));
+    }
+    return res;
+}
+
+// the response gets the ids of the request, the client checks them
+std::string with_ids(const std::string& request, std::string response) {
+    try {
+        const auto req = json::parse(request);
+        auto       res = json::parse(response);
+        if (req.is_object() && res.is_object()) {
+            res["id"] = req.value("id", json{});
+        } else if (req.is_array() && res.is_array() &&
+                   req.size() == res.size()) {
+            for (size_t i{}; i < req.size(); ++i)
+                if (res[i].is_object())
+                    res[i]["id"] = req[i].value("id", json{});
+        } else {
+            return response;
+        }
+        return res.dump();
+    } catch (const json::exception&) {
+        return response;  // served as it was recorded
+    }
+}
+}  // namespace
+
+namespace staff {
+
+string_view method_of(string_view message) noexcept {
+    if (message.starts_with('[')) return "batch"sv;
+    constexpr auto KEY = "\"method\":\""sv;
+    const auto     beg = message.find(KEY);
+    if (beg == string_view::npos) return "unknown"sv;
+    message.remove_prefix(beg + KEY.size());
+    return message.substr(0, message.find('"'));
+}
+
+struct Recorder::_Impl {
+    std::ofstream            _out;
+    steady_clock::time_point _start;
+    std::mutex               _mutex;
+
+    explicit _Impl(const fs::path& file)
+        : _out(file, std::ios::binary | std::ios::trunc),
+          _start(steady_clock::now()) {
+        if (!_out)
+            throw std::system_error{errno, std::generic_category(),
+                                    "rpc recording open"};
+    }
+};
+
+Recorder::Recorder(const fs::path& file)
+    : _impl(std::make_unique<_Impl>(file)) {}
+
+Recorder::Recorder(Recorder&&) noexcept = default;
+
+Recorder::~Recorder() = default;
+
+void Recorder::record(steady_clock::time_point start, microseconds took,
+                      int status, string_view host, string_view request,
+                      string_view response) {
+    const auto at =
+        std::chrono::duration_cast<microseconds>(start - _impl->_start);
+
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    _impl->_out << fmt::format("{} {} {} {} {} {}\n", at.count(), took.count(),
+                               status, host.empty() ? "-"sv : host,
+                               request.size(), response.size())
+                << request << response << '\n';
+    _impl->_out.flush();
+}
+
+struct Replay::_Impl {
+    std::vector<Exchange> _exchanges;
+    double                _speed;
+    size_t                _left;
+    std::mutex            _mutex;
+
+    _Impl(const fs::path& file, double speed)
+        : _exchanges(load(file)), _speed(speed), _left(_exchanges.size()) {}
+};
+
+Replay::Replay(const fs::path& file, double speed)
+    : _impl(std::make_unique<_Impl>(file, speed)) {}
+
+Replay::Replay(Replay&&) noexcept = default;
+
+Replay::~Replay() = default;
+
+string Replay::serve(string_view host, const string& request) {
+    const auto method = method_of(request);
+
+    Exchange* ex{};
+    {
+        std::lock_guard<std::mutex> lock(_impl->_mutex);
+        for (auto& e : _impl->_exchanges) {
+            if (e.served || (!host.empty() && e.host != host) ||
+                method_of(e.request) != method)
+                continue;
+            e.served = true;
+            --_impl->_left;
+            ex = &e;
+            break;
+        }
+    }
+    if (!ex)
+        throw std::runtime_error{
+            fmt::format("connection error: no {} left to replay", method)};
+
+    // a served exchange is not touched by other threads any more
+    if (_impl->_speed > 0)
+        std::this_thread::sleep_for(
+            std::chrono::duration_cast<microseconds>(ex->took / _impl->_speed));
+    if (ex->status == 0)
+        throw std::runtime_error{
+            fmt::format("connection error: {}", ex->response)};
+    if (ex->status != 200)
+        throw jsonrpccxx::JsonRpcException(
+            -32003, "http error: received status != 200");
+    return with_ids(request, ex->response);
+}
+
+size_t Replay::left() {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    return _impl->_left;
+}
+}  // namespace staff
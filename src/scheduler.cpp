@@ -0,0 +1,251 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+
+#include "fmt/core.h"
+#include "fmt/format.h"
+#include "sms_text.hpp"
+
+namespace spool {
+
+namespace {
+constexpr auto CLASSES = static_cast<size_t>(Priority::LOW) + 1;
+}  // namespace
+
+const string_view& as_strv(Priority prio) noexcept {
+    switch (prio) {
+        case Priority::CRITICAL:
+            return CRITICAL_SV;
+        case Priority::HIGH:
+            return HIGH_SV;
+        case Priority::NORMAL:
+            return NORMAL_SV;
+        case Priority::LOW:
+            return LOW_SV;
+        default:
+            return NORMAL_SV;
+    }
+}
+
+std::optional<Priority> priority_from(string_view name) noexcept {
+    const auto equals = [name](string_view sv) {
+        return std::equal(name.begin(), name.end(), sv.begin(), sv.end(),
+                          [](unsigned char a, unsigned char b) {
+                              return std::tolower(a) == b;
+                          });
+    };
+    for (size_t c{}; c < CLASSES; ++c) {
+        const auto prio = static_cast<Priority>(c);
+        if (equals(as_strv(prio))) return prio;
+    }
+    return std::nullopt;
+}
+
+struct Scheduler::_Impl {
+    struct Held {
+        Message                  msg;
+        steady_clock::time_point release;
+    };
+
+    std::array<std::deque<Message>, CLASSES> _queues;
+    std::map<string, Held>                   _held;    // by recipients
+    std::map<string, Held>                   _fanout;  // by content
+    seconds                                  _aging;
+    Coalescing                               _coalescing;
+    seconds                                  _fanout_window;
+    std::mutex                               _mutex;
+    std::condition_variable                  _cv;
+    size_t                                   _size;
+    size_t                                   _queued;
+    bool                                     _stopping;
+
+    _Impl(seconds aging, Coalescing coalescing, seconds fanout)
+        : _aging(aging),
+          _coalescing(coalescing),
+          _fanout_window(fanout),
+          _size{},
+          _queued{},
+          _stopping{} {}
+
+    inline void enqueue(Message&& msg) {
+        _queues[static_cast<size_t>(msg.priority)].push_back(std::move(msg));
+        ++_queued;
+    }
+
+    bool hold(Message& msg);
+    void fan_out(Message&& msg);
+    void release(steady_clock::time_point now);
+    void digest(Message& msg) const;
+
+    std::optional<steady_clock::time_point> next_release() const;
+
+    // the oldest message of each class is the one aged the most, so only
+    // the fronts are compared: lowest effective class, then longest wait;
+    // aging stops at HIGH, so a CRITICAL one is always taken first
+    std::deque<Message>& next() {
+        const auto now = steady_clock::now();
+
+        std::deque<Message>* best{};
+        long                 best_class{};
+        for (size_t c{}; c < CLASSES; ++c) {
+            auto& queue = _queues[c];
+            if (queue.empty()) continue;
+            const auto waited = now - queue.front().queued;
+            const auto climb  = _aging.count() > 0 ? waited / _aging : 0;
+            const auto top    = c == 0 ? 0L : long(Priority::HIGH);
+            const auto eff    = std::max(top, long(c) - long(climb));
+            if (!best || eff < best_class ||
+                (eff == best_class &&
+                 queue.front().queued < best->front().queued)) {
+                best       = &queue;
+                best_class = eff;
+            }
+        }
+        return *best;
+    }
+};
+
+// merges the message into the held one of the same recipients,
+// returns false when it has to be queued on its own
+bool Scheduler::_Impl::hold(Message& msg) {
+    if (_coalescing.window.count() <= 0 || msg.priority == Priority::CRITICAL)
+        return false;
+
+    const auto key = fmt::format("{}", fmt::join(msg.phone_numbers, ","));
+    const auto it  = _held.find(key);
+    if (it == _held.end()) {
+        _held.emplace(key, Held{std::move(msg), steady_clock::now() +
+                                                     _coalescing.window});
+        return true;
+    }
+    auto& held = it->second.msg;
+    held.files.insert(held.files.end(),
+                      std::make_move_iterator(msg.files.begin()),
+                      std::make_move_iterator(msg.files.end()));
+    held.content += '\n';
+    held.content += msg.content;
+    held.priority = std::min(held.priority, msg.priority);
+    return true;
+}
+
+// the same text to other recipients is sent with one request, so it
+// waits for the fan out window, then the recipients are merged
+void Scheduler::_Impl::fan_out(Message&& msg) {
+    if (_fanout_window.count() <= 0 || msg.priority == Priority::CRITICAL)
+        return enqueue(std::move(msg));
+
+    const auto it = _fanout.find(msg.content);
+    if (it == _fanout.end()) {
+        auto key = msg.content;
+        _fanout.emplace(std::move(key),
+                        Held{std::move(msg),
+                             steady_clock::now() + _fanout_window});
+        return;
+    }
+    auto& held = it->second.msg;
+    for (auto& num : msg.phone_numbers)
+        if (std::find(held.phone_numbers.begin(), held.phone_numbers.end(),
+                      num) == held.phone_numbers.end())
+            held.phone_numbers.push_back(std::move(num));
+    held.files.insert(held.files.end(),
+                      std::make_move_iterator(msg.files.begin()),
+                      std::make_move_iterator(msg.files.end()));
+    held.priority = std::min(held.priority, msg.priority);
+}
+
+void Scheduler::_Impl::release(steady_clock::time_point now) {
+    for (auto it = _held.begin(); it != _held.end();) {
+        if (it->second.release > now) {
+            ++it;
+            continue;
+        }
+        auto& msg = it->second.msg;
+        if (msg.files.size() > 1) digest(msg);
+        fan_out(std::move(msg));
+        it = _held.erase(it);
+    }
+    for (auto it = _fanout.begin(); it != _fanout.end();) {
+        if (it->second.release > now) {
+            ++it;
+            continue;
+        }
+        enqueue(std::move(it->second.msg));
+        it = _fanout.erase(it);
+    }
+}
+
+std::optional<steady_clock::time_point> Scheduler::_Impl::next_release()
+    const {
+    std::optional<steady_clock::time_point> until{};
+    for (const auto* held : {&_held, &_fanout})
+        for (const auto& [key, h] : *held)
+            if (!until || h.release < *until) until = h.release;
+    return until;
+}
+
+void Scheduler::_Impl::digest(Message& msg) const {
+    msg.content =
+        fmt::format("{} alerts:\n{}", msg.files.size(), msg.content);
+
+    msg.content = messages::truncate(msg.content, _coalescing.segments);
+}
+
+Scheduler::Scheduler(seconds aging, Coalescing coalescing, seconds fanout)
+    : _impl(std::make_unique<_Impl>(aging, coalescing, fanout)) {}
+
+Scheduler::Scheduler(Scheduler&&) noexcept = default;
+
+Scheduler::~Scheduler() = default;
+
+void Scheduler::push(Message msg) {
+    {
+        std::lock_guard<std::mutex> lock(_impl->_mutex);
+        _impl->_size += msg.files.size();
+        if (!_impl->hold(msg)) _impl->fan_out(std::move(msg));
+    }
+    // a held message may shorten the wait of a sender
+    _impl->_cv.notify_one();
+}
+
+std::optional<Message> Scheduler::pop() {
+    std::unique_lock<std::mutex> lock(_impl->_mutex);
+    for (;;) {
+        if (_impl->_stopping) return std::nullopt;
+
+        _impl->release(steady_clock::now());
+        if (_impl->_queued > 0) break;
+
+        if (const auto until = _impl->next_release())
+            _impl->_cv.wait_until(lock, *until);
+        else
+            _impl->_cv.wait(lock);
+    }
+
+    auto& queue = _impl->next();
+    auto  msg   = std::move(queue.front());
+    queue.pop_front();
+    --_impl->_queued;
+    _impl->_size -= msg.files.size();
+    return msg;
+}
+
+void Scheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_impl->_mutex);
+        _impl->_stopping = true;
+    }
+    _impl->_cv.notify_all();
+}
+
+size_t Scheduler::size() {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    return _impl->_size;
+}
+
+}  // namespace spool
@@ -0,0 +1,324 @@
+#include "sms_text.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+using namespace std::string_view_literals;
+using messages::Alphabet;
+using messages::TextInfo;
+using std::string_view;
+
+constexpr size_t GSM7_SINGLE = 160;
+constexpr size_t GSM7_MULTI  = 153;  // the rest is the UDH
+constexpr size_t UCS2_SINGLE = 70;
+constexpr size_t UCS2_MULTI  = 67;
+
+constexpr auto CUT_MARK = "..."sv;
+
+// septets of the ascii characters: 0 not in gsm-7, 2 via the escape table
+constexpr auto ASCII_SEPTETS = [] {
+    std::array<std::uint8_t, 128> t{};
+    for (size_t c{0x20}; c < 0x7F; ++c) t[c] = 1;
+    t['\n'] = t['\r'] = 1;
+    t['\f']           = 2;
+    for (const auto c : "[\\]^{|}~"sv) t[static_cast<size_t>(c)] = 2;
+    t['`'] = 0;
+    return t;
+}();
+
+// non ascii code points of the gsm-7 default alphabet, sorted
+constexpr char32_t GSM7_BASIC[] = {
+    0x00A1, 0x00A3, 0x00A4, 0x00A5, 0x00A7, 0x00BF, 0x00C4, 0x00C5,
+    0x00C6, 0x00C7, 0x00C9, 0x00D1, 0x00D6, 0x00D8, 0x00DC, 0x00DF,
+    0x00E0, 0x00E4, 0x00E5, 0x00E6, 0x00E8, 0x00E9, 0x00EC, 0x00F1,
+    0x00F2, 0x00F6, 0x00F8, 0x00F9, 0x00FC, 0x0393, 0x0394, 0x0398,
+    0x039B, 0x039E, 0x03A0, 0x03A3, 0x03A6, 0x03A8, 0x03A9,
+};
+constexpr char32_t EURO = 0x20AC;
+
+inline size_t septets(char32_t cp) noexcept {
+    if (cp < 0x80) return ASCII_SEPTETS[cp];
+    if (cp == EURO) return 2;
+    return std::binary_search(std::begin(GSM7_BASIC), std::end(GSM7_BASIC),
+                              cp)
+               ? 1
+               : 0;
+}
+
+inline size_t ucs2_units(char32_t cp) noexcept { return cp > 0xFFFF ? 2 : 1; }
+
+inline size_t cost(Alphabet a, char32_t cp) noexcept {
+    return a == Alphabet::GSM7 ? septets(cp) : ucs2_units(cp);
+}
+
+// decodes the code point at i of a valid utf-8 text and steps over it
+inline char32_t decode(string_view s, size_t& i) noexcept {
+    const auto b = static_cast<unsigned char>(s[i++]);
+    if (b < 0x80) return b;
+    const auto n  = b >= 0xF0 ? 3 : b >= 0xE0 ? 2 : 1;
+    char32_t   cp = b & (0x3F >> n);
+    for (int k{}; k < n; ++k)
+        cp = (cp << 6) | (static_cast<unsigned char>(s[i++]) & 0x3F);
+    return cp;
+}
+
+// length of the valid utf-8 sequence at i, 0 when it is invalid
+size_t sequence(string_view s, size_t i) noexcept {
+    const auto at = [s](size_t k) {
+        return static_cast<unsigned char>(s[k]);
+    };
+    const auto b = at(i);
+    if (b < 0x80) return 1;
+
+    size_t   n{};
+    char32_t min{};
+    if ((b & 0xE0) == 0xC0)
+        n = 2, min = 0x80;
+    else if ((b & 0xF0) == 0xE0)
+        n = 3, min = 0x800;
+    else if ((b & 0xF8) == 0xF0)
+        n = 4, min = 0x10000;
+    else
+        return 0;
+    if (i + n > s.size()) return 0;
+
+    char32_t cp = b & (0x7F >> n);
+    for (size_t k{1}; k < n; ++k) {
+        if ((at(i + k) & 0xC0) != 0x80) return 0;
+        cp = (cp << 6) | (at(i + k) & 0x3F);
+    }
+    // overlong forms, utf-16 surrogates and beyond the unicode range
+    if (cp < min || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF)
+        return 0;
+    return n;
+}
+
+#if defined(__SSE2__)
+constexpr size_t BLOCK = 16;
+
+inline bool ascii_block(const char* p) noexcept {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    return _mm_movemask_epi8(v) == 0;
+}
+
+// true when all 16 bytes are ascii characters of the gsm-7 basic table
+inline bool gsm7_basic_block(const char* p) noexcept {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    if (_mm_movemask_epi8(v) != 0) return false;
+
+    const auto in_range = [v](char lo, char span) {
+        const auto d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+        return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(span)), d);
+    };
+    // controls but LF and CR, [\]^ ` {|}~ and DEL
+    const auto ctrl = _mm_andnot_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))),
+        in_range(0x00, 0x1F));
+    const auto special =
+        _mm_or_si128(_mm_or_si128(in_range('[', 3), in_range('{', 4)),
+                     _mm_cmpeq_epi8(v, _mm_set1_epi8('`')));
+    return _mm_movemask_epi8(_mm_or_si128(ctrl, special)) == 0;
+}
+#endif
+
+// segments of a text, two unit characters are not split between segments
+size_t segments(string_view s, Alphabet a, size_t units, bool wide) {
+    const auto single = a == Alphabet::GSM7 ? GSM7_SINGLE : UCS2_SINGLE;
+    const auto multi  = a == Alphabet::GSM7 ? GSM7_MULTI : UCS2_MULTI;
+    if (units <= single) return 1;
+    if (!wide) return (units + multi - 1) / multi;
+
+    size_t segs{1}, used{};
+    for (size_t i{}; i < s.size();) {
+        const auto c = cost(a, decode(s, i));
+        if (used + c > multi) {
+            ++segs;
+            used = 0;
+        }
+        used += c;
+    }
+    return segs;
+}
+
+inline size_t capacity(Alphabet a, size_t segments) noexcept {
+    if (segments <= 1) return a == Alphabet::GSM7 ? GSM7_SINGLE : UCS2_SINGLE;
+    return segments * (a == Alphabet::GSM7 ? GSM7_MULTI : UCS2_MULTI);
+}
+
+// bytes of the longest prefix taking at most units in the alphabet
+size_t prefix(string_view s, Alphabet a, size_t units) {
+    size_t used{}, i{};
+    while (i < s.size()) {
+        auto       next = i;
+        const auto c    = cost(a, decode(s, next));
+        if (used + c > units) break;
+        used += c;
+        i = next;
+    }
+    return i;
+}
+}  // namespace
+
+namespace messages {
+
+const string_view& as_strv(Alphabet a) noexcept {
+    switch (a) {
+        case Alphabet::GSM7:
+            return GSM7_SV;
+        case Alphabet::UCS2:
+            return UCS2_SV;
+        default:
+            return UCS2_SV;
+    }
+}
+
+const string_view& as_strv(OverLength ol) noexcept {
+    switch (ol) {
+        case OverLength::SEND:
+            return SEND_SV;
+        case OverLength::TRUNCATE:
+            return TRUNCATE_SV;
+        case OverLength::SPLIT:
+            return SPLIT_SV;
+        case OverLength::REJECT:
+            return REJECT_SV;
+        default:
+            return SEND_SV;
+    }
+}
+
+std::optional<OverLength> over_length_from(string_view name) noexcept {
+    for (const auto ol : {OverLength::SEND, OverLength::TRUNCATE,
+                          OverLength::SPLIT, OverLength::REJECT})
+        if (as_strv(ol) == name) return ol;
+    return std::nullopt;
+}
+
+bool valid_utf8(string_view text) noexcept {
+    size_t i{};
+    while (i < text.size()) {
+#if defined(__SSE2__)
+        if (i + BLOCK <= text.size() && ascii_block(text.data() + i)) {
+            i += BLOCK;
+            continue;
+        }
+#endif
+        const auto n = sequence(text, i);
+        if (n == 0) return false;
+        i += n;
+    }
+    return true;
+}
+
+string sanitize_utf8(string_view text) {
+    string res{};
+    res.reserve(text.size());
+    for (size_t i{}; i < text.size();) {
+        const auto n = sequence(text, i);
+        if (n == 0) {
+            res += '?';
+            ++i;
+        } else {
+            res.append(text.substr(i, n));
+            i += n;
+        }
+    }
+    return res;
+}
+
+TextInfo inspect(string_view text) noexcept {
+    size_t gsm7{}, ucs2{};
+    bool   gsm7_ok{true}, escaped{}, surrogates{};
+
+    for (size_t i{}; i < text.size();) {
+#if defined(__SSE2__)
+        if (i + BLOCK <= text.size() && gsm7_basic_block(text.data() + i)) {
+            gsm7 += BLOCK;
+            ucs2 += BLOCK;
+            i += BLOCK;
+            continue;
+        }
+#endif
+        const auto cp = decode(text, i);
+        const auto s  = septets(cp);
+        const auto u  = ucs2_units(cp);
+        gsm7_ok       = gsm7_ok && s > 0;
+        escaped       = escaped || s > 1;
+        surrogates    = surrogates || u > 1;
+        gsm7 += s;
+        ucs2 += u;
+    }
+
+    if (gsm7_ok)
+        return {Alphabet::GSM7, gsm7,
+                segments(text, Alphabet::GSM7, gsm7, escaped)};
+    return {Alphabet::UCS2, ucs2,
+            segments(text, Alphabet::UCS2, ucs2, surrogates)};
+}
+
+string truncate(string_view text, size_t segs) {
+    segs            = std::max<size_t>(1, segs);
+    const auto info = inspect(text);
+    if (info.segments <= segs) return string{text};
+
+    // the unit budget ignores that two unit characters are not split
+    // between segments, so it is shortened until the result fits
+    auto units = capacity(info.alphabet, segs) - CUT_MARK.size();
+    for (;;) {
+        const auto len = prefix(text, info.alphabet, units);
+        auto       res = string{text.substr(0, len)};
+        res += CUT_MARK;
+        if (inspect(res).segments <= segs || units == 0) return res;
+        --units;
+    }
+}
+
+vector<string> split(string_view text, size_t segs) {
+    segs = std::max<size_t>(1, segs);
+    vector<string> parts{};
+
+    while (!text.empty()) {
+        const auto info = inspect(text);
+        if (info.segments <= segs) {
+            parts.emplace_back(text);
+            break;
+        }
+        auto units = capacity(info.alphabet, segs);
+        auto len   = prefix(text, info.alphabet, units);
+        while (inspect(text.substr(0, len)).segments > segs && len > 1)
+            len = prefix(text, info.alphabet, --units);
+
+        // break at the last white space of the last fifth, if there is one
+        const auto space = text.substr(0, len).find_last_of(" \t\n");
+        if (space != string_view::npos && space > len - len / 5)
+            len = space + 1;
+
+        parts.emplace_back(text.substr(0, len));
+        text.remove_prefix(len);
+    }
+    return parts;
+}
+
+vector<string> fit(string text, size_t max_segments, OverLength policy) {
+    if (max_segments == 0 || policy == OverLength::SEND ||
+        inspect(text).segments <= max_segments)
+        return {std::move(text)};
+
+    switch (policy) {
+        case OverLength::TRUNCATE:
+            return {truncate(text, max_segments)};
+        case OverLength::SPLIT:
+            return split(text, max_segments);
+        default:
+            return {};
+    }
+}
+
+}  // namespace messages
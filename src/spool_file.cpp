@@ -0,0 +1,278 @@
+#include "spool_file.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#include "fmt/chrono.h"
+#include "fmt/core.h"
+#include "string_trim.hpp"
+
+namespace {
+using namespace std::string_view_literals;
+
+using spool::Charset;
+using std::string;
+using std::string_view;
+
+std::system_error errno_error(const char* what) {
+    return std::system_error{errno, std::generic_category(), what};
+}
+
+class FileDescriptor {
+    int _fd;
+
+   public:
+    explicit FileDescriptor(int fd) noexcept : _fd(fd) {}
+    FileDescriptor(const FileDescriptor&)            = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+    ~FileDescriptor() {
+        if (_fd >= 0) ::close(_fd);
+    }
+
+    int get() const noexcept { return _fd; }
+};
+
+bool iequals(string_view a, string_view b) noexcept {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [](unsigned char x, unsigned char y) {
+                          return std::tolower(x) == std::tolower(y);
+                      });
+}
+
+bool yes(string_view value) noexcept {
+    return iequals(value, "yes"sv) || iequals(value, "true"sv) ||
+           value == "1"sv;
+}
+
+Charset charset_from(string_view value) {
+    for (const auto name : {"UTF-8"sv, "UTF8"sv})
+        if (iequals(value, name)) return Charset::UTF8;
+    for (const auto name : {"ISO"sv, "Latin"sv, "ANSI"sv, "GSM"sv})
+        if (iequals(value, name)) return Charset::ISO;
+    for (const auto name : {"UCS"sv, "UCS2"sv, "UCS-2"sv})
+        if (iequals(value, name)) return Charset::UCS2;
+    throw std::invalid_argument{
+        fmt::format("alphabet {} is not sendable as a text SMS", value)};
+}
+
+void append_utf8(string& out, char32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// iso-8859-15 is latin-1 but these eight code points
+char32_t iso_8859_15(unsigned char c) noexcept {
+    switch (c) {
+        case 0xA4:
+            return 0x20AC;
+        case 0xA6:
+            return 0x0160;
+        case 0xA8:
+            return 0x0161;
+        case 0xB4:
+            return 0x017D;
+        case 0xB8:
+            return 0x017E;
+        case 0xBC:
+            return 0x0152;
+        case 0xBD:
+            return 0x0153;
+        case 0xBE:
+            return 0x0178;
+        default:
+            return c;
+    }
+}
+
+string from_iso(string_view body) {
+    string res{};
+    res.reserve(body.size() * 2);
+    for (const auto c : body)
+        append_utf8(res, iso_8859_15(static_cast<unsigned char>(c)));
+    return res;
+}
+
+// smsd writes ucs-2 bodies big endian, surrogate pairs are joined
+string from_ucs2(string_view body) {
+    if (body.size() % 2 != 0)
+        throw std::invalid_argument{"odd length of an UCS-2 body"};
+
+    string     res{};
+    const auto unit = [body](size_t i) -> char32_t {
+        return static_cast<unsigned char>(body[i]) << 8 |
+               static_cast<unsigned char>(body[i + 1]);
+    };
+    res.reserve(body.size() * 3 / 2);
+    for (size_t i{}; i < body.size(); i += 2) {
+        auto cp = unit(i);
+        if (cp >= 0xD800 && cp <= 0xDBFF && i + 2 < body.size()) {
+            const auto low = unit(i + 2);
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                i += 2;
+            }
+        }
+        if (cp >= 0xD800 && cp <= 0xDFFF) cp = '?';
+        append_utf8(res, cp);
+    }
+    return res;
+}
+}  // namespace
+
+namespace spool {
+
+const string_view& as_strv(Charset cs) noexcept {
+    switch (cs) {
+        case Charset::UTF8:
+            return UTF8_SV;
+        case Charset::ISO:
+            return ISO_SV;
+        case Charset::UCS2:
+            return UCS2_SV;
+        default:
+            return UTF8_SV;
+    }
+}
+
+string read_spool_file(const fs::path& file, size_t max_size) {
+    const FileDescriptor fd{::open(file.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd.get() < 0) throw errno_error("spool file open");
+
+    struct stat st {};
+    if (::fstat(fd.get(), &st) != 0) throw errno_error("spool file stat");
+    const auto size = static_cast<size_t>(st.st_size);
+    if (size > max_size)
+        throw std::length_error{
+            fmt::format("{} bytes over the {} limit", size, max_size)};
+
+    // one byte more than the size to notice a file still being written
+    string text(size + 1, '\0');
+    size_t got{};
+    while (got < text.size()) {
+        const auto n = ::read(fd.get(), text.data() + got, text.size() - got);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw errno_error("spool file read");
+        }
+        if (n == 0) break;
+        got += static_cast<size_t>(n);
+    }
+    if (got > max_size)
+        throw std::length_error{
+            fmt::format("file grew over the {} bytes limit", max_size)};
+    text.resize(got);
+    return text;
+}
+
+SpoolFile parse_spool_file(string_view text) {
+    SpoolFile file{{}, {}, false, Charset::UTF8, {}};
+
+    if (text.starts_with("\xEF\xBB\xBF"sv)) text.remove_prefix(3);
+
+    // headers up to the first empty line, then the message body
+    while (!text.empty()) {
+        const auto eol  = text.find('\n');
+        const auto line = trim_sv(text.substr(0, eol));
+        text.remove_prefix(eol == string_view::npos ? text.size() : eol + 1);
+        if (line.empty()) break;
+
+        const auto i = line.find(':');
+        if (i == string_view::npos) continue;
+        const auto key   = trim_sv(line.substr(0, i));
+        const auto value = trim_sv(line.substr(i + 1));
+
+        if (iequals(key, "To"sv)) {
+            if (value.empty())
+                throw std::invalid_argument{"no value in to field (empty)"};
+            file.to.push_back(value);
+        } else if (iequals(key, "Priority"sv)) {
+            file.priority = value;
+        } else if (iequals(key, "Flash"sv)) {
+            file.flash = yes(value);
+        } else if (iequals(key, "Alphabet"sv)) {
+            file.charset = charset_from(value);
+        } else if (iequals(key, "Voicecall"sv) && yes(value)) {
+            throw std::invalid_argument{"voice calls are not supported"};
+        }
+        // From, SMSC, Report, Autosplit, Validity, UDH, Queue, Provider
+        // and the others tune the modem of smsd and have no dongle pair
+    }
+    if (file.to.empty())
+        throw std::invalid_argument{"no To field specified in file"};
+
+    file.body = text;
+    return file;
+}
+
+string take_body(string&& text, const SpoolFile& file) {
+    switch (file.charset) {
+        case Charset::ISO:
+            return from_iso(file.body);
+        case Charset::UCS2:
+            return from_ucs2(file.body);
+        default:
+            break;
+    }
+    const auto offset = static_cast<size_t>(file.body.data() - text.data());
+    text.erase(0, offset);
+    return std::move(text);
+}
+
+string format_incoming_file(const IncomingFile& file) {
+    std::tm sent{}, received{};
+    ::localtime_r(&file.sent, &sent);
+    ::localtime_r(&file.received, &received);
+    const auto from   = file.from.starts_with('+') ? file.from.substr(1)
+                                                   : file.from;
+    const auto length = std::count_if(
+        file.body.begin(), file.body.end(),
+        [](char c) { return (static_cast<unsigned char>(c) & 0xC0) != 0x80; });
+    return fmt::format(
+        "From: {}\nSent: {:%y-%m-%d %H:%M:%S}\nReceived: {:%y-%m-%d "
+        "%H:%M:%S}\nSubject: {}\nModem: {}\nAlphabet: {}\nLength: {}\n\n{}",
+        from, sent, received, file.modem, file.modem, UTF8_SV, length,
+        file.body);
+}
+
+void write_spool_file(const fs::path& dir, const string& name,
+                      string_view text) {
+    const auto tmp = dir / fmt::format(".{}", name);
+    {
+        const FileDescriptor fd{::open(tmp.c_str(),
+                                       O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                       0644)};
+        if (fd.get() < 0) throw errno_error("spool file create");
+        while (!text.empty()) {
+            const auto n = ::write(fd.get(), text.data(), text.size());
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw errno_error("spool file write");
+            }
+            text.remove_prefix(static_cast<size_t>(n));
+        }
+        if (::fsync(fd.get()) != 0) throw errno_error("spool file sync");
+    }
+    fs::rename(tmp, dir / name);
+}
+
+}  // namespace spool
@@ -0,0 +1,151 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <system_error>
+
+#include "nlohmann/json.hpp"
+
+namespace {
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::system_clock;
+
+using Stage = spool::Trace::Stage;
+
+constexpr size_t RECENT = 4096;  // samples kept per stage for the summary
+}  // namespace
+
+namespace spool {
+
+struct Trace::_Impl {
+    /// the recent samples of a stage, the oldest is overwritten
+    struct Ring {
+        vector<std::int64_t> samples;
+        size_t               next;
+        size_t               count;
+    };
+
+    std::ofstream            _out;
+    std::array<Ring, STAGES> _recent;
+    std::mutex               _mutex;
+
+    explicit _Impl(const fs::path& file)
+        : _out(file, std::ios::app), _recent{} {
+        if (!_out)
+            throw std::system_error{errno, std::generic_category(),
+                                    "trace file open"};
+    }
+
+    void sample(size_t stage, std::int64_t us) {
+        auto& ring = _recent[stage];
+        if (ring.samples.size() < RECENT)
+            ring.samples.push_back(us);
+        else
+            ring.samples[ring.next] = us;
+        ring.next = (ring.next + 1) % RECENT;
+        ++ring.count;
+    }
+
+    void write(const nlohmann::ordered_json& line) {
+        _out << line.dump() << '\n';
+        _out.flush();
+    }
+};
+
+Trace::Trace(const fs::path& file) : _impl(std::make_unique<_Impl>(file)) {}
+
+Trace::Trace(Trace&&) noexcept = default;
+
+Trace::~Trace() = default;
+
+const string_view& Trace::as_strv(Stage st) noexcept {
+    switch (st) {
+        case Stage::SEEN:
+            return SEEN_SV;
+        case Stage::PARSED:
+            return PARSED_SV;
+        case Stage::QUEUED:
+            return QUEUED_SV;
+        case Stage::POSTED:
+            return POSTED_SV;
+        case Stage::POLLED:
+            return POLLED_SV;
+        case Stage::SENT:
+            return SENT_SV;
+        case Stage::MOVED:
+            return MOVED_SV;
+        default:
+            return SEEN_SV;
+    }
+}
+
+void Trace::record(const vector<fs::path>& files, const Stamps& stamps,
+                   bool succeeded) {
+    const auto& seen = stamps[static_cast<size_t>(Stage::SEEN)];
+
+    // the offsets are from the file event, so a record reads as a timeline
+    auto line     = nlohmann::ordered_json::object();
+    auto offsets  = nlohmann::ordered_json::object();
+    auto previous = seen;
+    for (size_t i{}; i < STAGES; ++i) {
+        if (stamps[i] == steady_clock::time_point{}) continue;
+        offsets[std::string{as_strv(static_cast<Stage>(i))}] =
+            duration_cast<microseconds>(stamps[i] - seen).count();
+    }
+    const auto wall = system_clock::now() - (steady_clock::now() - seen);
+    line["seen_ms"] =
+        duration_cast<milliseconds>(wall.time_since_epoch()).count();
+    line["files"] = nlohmann::ordered_json::array();
+    for (const auto& file : files) line["files"].push_back(file.string());
+    line["status"] = succeeded ? "succeeded" : "failed";
+    line["us"]     = std::move(offsets);
+
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    for (size_t i = 1; i < STAGES; ++i) {
+        if (stamps[i] == steady_clock::time_point{}) continue;
+        if (previous != steady_clock::time_point{})
+            _impl->sample(
+                i, duration_cast<microseconds>(stamps[i] - previous).count());
+        previous = stamps[i];
+    }
+    _impl->write(line);
+}
+
+vector<Trace::Summary> Trace::summary() {
+    vector<Summary> res{};
+
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    for (size_t i = 1; i < STAGES; ++i) {
+        auto samples = _impl->_recent[i].samples;
+        if (samples.empty()) continue;
+
+        const auto at = [&samples](size_t pct) {
+            const auto nth = samples.begin() + (samples.size() - 1) * pct / 100;
+            std::nth_element(samples.begin(), nth, samples.end());
+            return microseconds{*nth};
+        };
+        const auto p50 = at(50);
+        res.push_back({static_cast<Stage>(i), _impl->_recent[i].count, p50,
+                       at(99)});
+    }
+    return res;
+}
+
+void Trace::write_summary() {
+    auto stages = nlohmann::ordered_json::object();
+    for (const auto& sum : summary())
+        stages[std::string{as_strv(sum.stage)}] = {
+            {"count", sum.count},
+            {"p50_us", sum.p50.count()},
+            {"p99_us", sum.p99.count()}};
+
+    nlohmann::ordered_json line = {{"summary", std::move(stages)}};
+
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    _impl->write(line);
+}
+}  // namespace spool
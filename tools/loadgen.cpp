@@ -0,0 +1,295 @@
+// load generator of the watch mode: writes smsd spool files into the
+// watched directory at a rate, in bursts, and follows each of them until
+// the daemon moves it into the move to directory
+//
+// usage: asmsd-loadgen --watch in --move-to out [--count 1000] [--rate 50]
+
+#include "reactor.hpp"
+
+#include <poll.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "cxxopts.hpp"
+#include "fmt/core.h"
+
+namespace {
+namespace fs = std::filesystem;
+using namespace std::string_view_literals;
+
+using std::string;
+using std::string_view;
+using std::vector;
+using std::chrono::duration;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+/// shape of the generated load
+struct Shape {
+    size_t count;       // files written in all
+    double rate;        // files per second, zero writes them at once
+    size_t burst;       // files written back to back every burst / rate
+    double recipients;  // mean of the recipients of a file
+    size_t max_recips;  // recipients of a file at most
+    double length;      // mean of the text length in characters
+    double length_sd;   // deviation of the text length
+    double unicode;     // share of the texts out of the GSM-7 alphabet
+};
+
+constexpr std::array GSM_WORDS = {"CRIT"sv, "db01/Filesystem"sv, "/var:"sv,
+                                  "97.1%"sv, "used"sv, "(48.5"sv, "of"sv,
+                                  "50.0"sv, "GB)"sv};
+constexpr std::array UCS2_WORDS = {"árvíztűrő"sv, "tükörfúrógép"sv,
+                                   "ÁRVÍZTŰRŐ"sv, "TÜKÖRFÚRÓGÉP"sv};
+
+size_t chars_of(string_view word) {
+    return std::count_if(word.begin(), word.end(),
+                         [](char c) { return (c & 0xC0) != 0x80; });
+}
+
+/// one written file on its way to the move to directory
+struct Tracked {
+    steady_clock::time_point written;
+    steady_clock::time_point moved;
+    size_t                   arrivals;
+};
+
+class Generator {
+    const Shape& _shape;
+    std::mt19937 _random;
+
+   public:
+    Generator(const Shape& shape, std::uint32_t seed)
+        : _shape(shape), _random(seed) {}
+
+    // the distributions take a positive mean and deviation only, they are
+    // not drawn from for zero
+    string spool_file(size_t seq) {
+        const bool extras = _shape.recipients > 1;
+        const bool spread = _shape.length_sd > 0;
+        std::poisson_distribution<size_t> extra{
+            extras ? _shape.recipients - 1 : 1.0};
+        std::uniform_int_distribution<int> number{0, 9999999};
+        std::normal_distribution<double>   length{
+            _shape.length, spread ? _shape.length_sd : 1.0};
+        std::bernoulli_distribution        unicode{_shape.unicode};
+
+        string text{};
+        const auto recipients = std::min(
+            _shape.max_recips, 1 + (extras ? extra(_random) : size_t{}));
+        for (size_t i{}; i < recipients; ++i)
+            text += fmt::format("To: +3630{:07}\n", number(_random));
+        text += '\n';
+
+        // the sequence keeps the texts apart, so nothing is merged
+        text += fmt::format("loadgen #{} ", seq);
+        const auto chars = static_cast<size_t>(
+            std::clamp(spread ? length(_random) : _shape.length, 1.0, 2000.0));
+        const bool ucs2 = unicode(_random);
+        for (size_t i{}, n{}; n < chars; ++i) {
+            const auto word = ucs2 ? UCS2_WORDS[i % UCS2_WORDS.size()]
+                                   : GSM_WORDS[i % GSM_WORDS.size()];
+            text += word;
+            text += ' ';
+            n += chars_of(word) + 1;
+        }
+        text += '\n';
+        return text;
+    }
+};
+
+struct Report {
+    size_t                   written;
+    size_t                   delivered;
+    size_t                   pending;     // still in the watched directory
+    size_t                   vanished;    // neither there nor moved
+    size_t                   duplicated;  // moved in more times
+    size_t                   unknown;     // moved in, not written by us
+    duration<double>         span;        // first write to last move
+    vector<duration<double>> latencies;
+};
+
+double percentile(vector<duration<double>>& sorted, double pct) {
+    if (sorted.empty()) return 0;
+    const auto i = static_cast<size_t>(
+        pct / 100 * static_cast<double>(sorted.size() - 1));
+    return sorted[i].count() * 1e3;
+}
+
+void print(Report& rep) {
+    std::sort(rep.latencies.begin(), rep.latencies.end());
+    fmt::print("written {}, delivered {}, pending {}, vanished {}, "
+               "duplicated {}, unknown {}\n",
+               rep.written, rep.delivered, rep.pending, rep.vanished,
+               rep.duplicated, rep.unknown);
+    if (rep.delivered == 0) return;
+    fmt::print("throughput {:.1f} files/s over {:.2f} s\n",
+               static_cast<double>(rep.delivered) / rep.span.count(),
+               rep.span.count());
+    fmt::print("latency ms: p50 {:.1f}, p90 {:.1f}, p99 {:.1f}, max {:.1f}\n",
+               percentile(rep.latencies, 50), percentile(rep.latencies, 90),
+               percentile(rep.latencies, 99), percentile(rep.latencies, 100));
+}
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    using cxxopts::value;
+
+    cxxopts::Options opts("asmsd-loadgen", "load generator of asmsd --watch");
+
+    fs::path      watch{}, move_to{}, staging{};
+    Shape         shape{};
+    long          timeout{};
+    std::uint32_t seed{};
+
+    opts.set_width(90).add_options()  //
+        ("w,watch", "the directory asmsd watches", value(watch))(
+            "m,move-to", "the directory asmsd moves the sent files to",
+            value(move_to))(
+            "staging", "files are written here then moved into the watched "
+                       "one, default: next to it",
+            value(staging))(
+            "n,count", "files to write",
+            value(shape.count)->default_value("1000"))(
+            "r,rate", "files per second, 0 writes them at once",
+            value(shape.rate)->default_value("50"))(
+            "burst", "files written back to back at a time",
+            value(shape.burst)->default_value("1"))(
+            "recipients", "mean of the recipients of a file",
+            value(shape.recipients)->default_value("1.5"))(
+            "max-recipients", "recipients of a file at most",
+            value(shape.max_recips)->default_value("20"))(
+            "length", "mean of the text length in characters",
+            value(shape.length)->default_value("80"))(
+            "length-sd", "deviation of the text length",
+            value(shape.length_sd)->default_value("40"))(
+            "unicode", "share of the texts out of the GSM-7 alphabet",
+            value(shape.unicode)->default_value("0.1"))(
+            "timeout", "seconds waited for the files after the last write",
+            value(timeout)->default_value("60"))(
+            "seed", "seed of the distributions",
+            value(seed)->default_value("1"))("help", "print usage");
+
+    try {
+        const auto result = opts.parse(argc, argv);
+        if (result.count("help")) {
+            fmt::print("{}", opts.help());
+            return EXIT_SUCCESS;
+        }
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "{}, see usage: asmsd-loadgen --help\n", e.what());
+        return EX_USAGE;
+    }
+    if (!fs::is_directory(watch) || !fs::is_directory(move_to) ||
+        shape.burst == 0 || shape.unicode < 0 || shape.unicode > 1 ||
+        shape.recipients < 1 || shape.length_sd < 0) {
+        fmt::print(stderr, "see usage: asmsd-loadgen --help\n");
+        return EX_USAGE;
+    }
+    // written aside and renamed in, so the daemon never reads a partial one
+    if (staging.empty())
+        staging = fs::absolute(watch).parent_path() /
+                  fmt::format(".asmsd-loadgen-{}", ::getpid());
+    fs::create_directories(staging);
+
+    const auto prefix = fmt::format("loadgen-{}-", ::getpid());
+
+    std::mutex                mutex;
+    std::map<string, Tracked> tracked;
+    size_t                    delivered{}, duplicated{}, unknown{};
+    steady_clock::time_point  last_move{};
+    std::atomic<bool>         stopping{};
+
+    spool::DirectoryWatch moved{move_to};
+    std::thread           follower([&]() {
+        pollfd pfd{moved.fd(), POLLIN, 0};
+        while (!stopping) {
+            if (::poll(&pfd, 1, 100) <= 0) continue;
+            const auto files = moved.read();
+            const auto now   = steady_clock::now();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto& file : files) {
+                const auto it = tracked.find(file.filename().string());
+                if (it == tracked.end()) {
+                    if (file.filename().string().starts_with(prefix))
+                        ++unknown;
+                    continue;
+                }
+                if (it->second.arrivals++ > 0) {
+                    ++duplicated;
+                    continue;
+                }
+                it->second.moved = now;
+                last_move        = now;
+                ++delivered;
+            }
+        }
+    });
+
+    Generator  gen{shape, seed};
+    const auto start = steady_clock::now();
+    for (size_t seq{}; seq < shape.count; ++seq) {
+        if (shape.rate > 0 && seq % shape.burst == 0)
+            std::this_thread::sleep_until(
+                start + std::chrono::duration_cast<steady_clock::duration>(
+                            duration<double>{static_cast<double>(seq) /
+                                             shape.rate}));
+
+        const auto name = fmt::format("{}{:06}", prefix, seq);
+        std::ofstream{staging / name, std::ios::binary} << gen.spool_file(seq);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tracked[name] = {steady_clock::now(), {}, 0};
+        }
+        fs::rename(staging / name, watch / name);
+    }
+    const auto written = steady_clock::now();
+    fmt::print("written {} files in {:.2f} s\n", shape.count,
+               duration<double>(written - start).count());
+
+    const auto deadline = written + std::chrono::seconds{timeout};
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (delivered >= shape.count) break;
+        }
+        if (steady_clock::now() >= deadline) break;
+        std::this_thread::sleep_for(milliseconds{50});
+    }
+    // late duplicates of the last files are still caught
+    std::this_thread::sleep_for(milliseconds{200});
+    stopping = true;
+    follower.join();
+    fs::remove_all(staging);
+
+    Report rep{shape.count, delivered, 0, 0, duplicated, unknown,
+               last_move - start, {}};
+    for (const auto& [name, t] : tracked) {
+        if (t.arrivals > 0)
+            rep.latencies.push_back(t.moved - t.written);
+        else if (fs::exists(watch / name))
+            ++rep.pending;
+        else
+            ++rep.vanished;
+    }
+    print(rep);
+    return rep.delivered == rep.written && rep.duplicated == 0 ? EXIT_SUCCESS
+                                                                : EXIT_FAILURE;
+}
@@ -0,0 +1,379 @@
+#include "mock_device.hpp"
+
+#include <time.h>
+
+#include <algorithm>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "fmt/chrono.h"
+#include "fmt/core.h"
+#include "nlohmann/json.hpp"
+
+namespace {
+using json = nlohmann::json;
+
+using std::chrono::steady_clock;
+
+// the wire values of the messages enums
+enum SmsType : int { READ, UNREAD, SENT, FAILED };
+enum SendStatus : int { NONE, SENDING, SUCCESS, RETRYING, FULL, SEND_FAILED };
+enum DelFlag : int { ALL, CONTACT, CONTENT };
+enum SmsState : int { NORMAL = 2, NEW = 3, STORAGE_FULL = 1 };
+
+constexpr int METHOD_NOT_FOUND = -32601;
+constexpr int INVALID_PARAMS   = -32602;
+constexpr int PARSE_ERROR      = -32700;
+constexpr int BUSY             = -32000;
+
+struct RpcError {
+    int         code;
+    std::string message;
+};
+
+std::string local_time(std::time_t t, const char* format) {
+    std::tm tm{};
+    ::localtime_r(&t, &tm);
+    return fmt::format(fmt::runtime(format), tm);
+}
+}  // namespace
+
+namespace mock {
+
+struct Device::_Impl {
+    struct Sms {
+        int         id;
+        int         contact_id;
+        int         type;
+        string      content;
+        std::time_t time;
+    };
+
+    struct Contact {
+        int            id;
+        vector<string> numbers;
+    };
+
+    Config                   _config;
+    std::mutex               _mutex;
+    std::mt19937             _random;
+    std::map<int, Contact>   _contacts;
+    vector<Sms>              _smses;  // in the order they were stored
+    std::map<string, size_t> _counts;
+    int                      _last_id;
+    int                      _send_status;
+    int                      _send_outcome;
+    steady_clock::time_point _send_done;
+
+    explicit _Impl(Config config)
+        : _config(config),
+          _random(config.seed),
+          _last_id{},
+          _send_status{NONE},
+          _send_outcome{NONE} {
+        for (size_t i{}; i < _config.inbox; ++i)
+            store(contact({fmt::format("+3670{:07}", i % 7)}), UNREAD,
+                  fmt::format("incoming message #{}", i + 1));
+    }
+
+    bool chance(double share) {
+        return share > 0 &&
+               std::uniform_real_distribution<double>{}(_random) < share;
+    }
+
+    milliseconds delay() {
+        if (_config.jitter.count() <= 0) return _config.latency;
+        return _config.latency +
+               milliseconds{std::uniform_int_distribution<long>{
+                   0, _config.jitter.count()}(_random)};
+    }
+
+    bool full() const noexcept { return _smses.size() >= _config.storage; }
+
+    size_t unread() const {
+        return std::count_if(_smses.begin(), _smses.end(),
+                             [](const Sms& s) { return s.type == UNREAD; });
+    }
+
+    int contact(const vector<string>& numbers) {
+        for (const auto& [id, c] : _contacts)
+            if (c.numbers == numbers) return id;
+        const auto id = ++_last_id;
+        _contacts.emplace(id, Contact{id, numbers});
+        return id;
+    }
+
+    void store(int contact_id, int type, string content) {
+        _smses.push_back(Sms{++_last_id, contact_id, type, std::move(content),
+                             std::time(nullptr)});
+    }
+
+    json sms_json(const Sms& s) const {
+        return {{"SMSId", s.id},
+                {"SMSType", s.type},
+                {"ReportStatus", 0},
+                {"sms_report", 0},
+                {"report_id", 0},
+                {"SMSContent", s.content},
+                {"SMSTime", local_time(s.time, "{:%Y-%m-%d %H:%M:%S}")},
+                {"report_time", local_time(s.time, "{:%Y-%b-%d %H:%M:%S}")},
+                {"SMSTimezone", 0}};
+    }
+
+    json system_info() const {
+        return {{"DeviceName", "IK41VE"},
+                {"HwVersion", "mock"},
+                {"HttpApiVersion", "V3.0"},
+                {"ICCID", "89360000000000000000"},
+                {"IMEI", "350000000000000"},
+                {"IMEISV", "35000000000000000"},
+                {"IMSI", "216000000000000"},
+                {"BuildTime", "2020-01-01 00:00:00"},
+                {"MacAddress", "00:11:22:33:44:55"}};
+    }
+
+    json system_status() const {
+        return {{"NetworkName", "mock"},
+                {"SignalStrength", 4},
+                {"Conprofileerror", 0},
+                {"ClearCode", 0},
+                {"mPdpRejectCount", 0},
+                {"NetworkType", 8},
+                {"ConnectionStatus", 2},
+                {"SmsState", full() ? STORAGE_FULL : unread() ? NEW : NORMAL},
+                {"Roaming", 0},
+                {"Domestic_Roaming", 0}};
+    }
+
+    json connection_state() const {
+        return {{"ConnectionStatus", 2}, {"Conprofileerror", 0},
+                {"ClearCode", 0},        {"mPdpRejectCount", 0},
+                {"IPv4Adrress", "10.0.0.2"},
+                {"IPv6Adrress", "::1"},  {"Speed_Dl", 0},
+                {"Speed_Ul", 0},         {"DlRate", 0},
+                {"UlRate", 0},           {"ConnectionTime", 0},
+                {"UlBytes", 0},          {"DlBytes", 0}};
+    }
+
+    json storage_state() const {
+        const auto used = static_cast<int>(_smses.size());
+        const auto max  = static_cast<int>(_config.storage);
+        return {{"UnreadReport", 0},
+                {"LeftCount", std::max(0, max - used)},
+                {"MaxCount", max},
+                {"TUseCount", used},
+                {"UnreadSMSCount", unread()}};
+    }
+
+    // contacts by their latest SMS, the newest first
+    json contact_list(const json& params) const {
+        struct Latest {
+            const Contact* contact;
+            const Sms*     sms;
+            size_t         unread;
+            size_t         count;
+        };
+        std::map<int, Latest> by_contact{};
+        for (const auto& s : _smses) {
+            auto& l = by_contact[s.contact_id];
+            l       = {&_contacts.at(s.contact_id), &s,
+                       l.unread + (s.type == UNREAD), l.count + 1};
+        }
+        vector<Latest> latest{};
+        for (const auto& [id, l] : by_contact) latest.push_back(l);
+        std::sort(latest.begin(), latest.end(),
+                  [](const Latest& a, const Latest& b) {
+                      return a.sms->id > b.sms->id;
+                  });
+
+        const auto page = params.value("Page", size_t{});
+        auto       list = json::array();
+        for (size_t i = page * _config.page_size;
+             i < std::min(latest.size(), (page + 1) * _config.page_size); ++i) {
+            auto item           = sms_json(*latest[i].sms);
+            item["ContactId"]   = latest[i].contact->id;
+            item["PhoneNumber"] = latest[i].contact->numbers;
+            item["UnreadCount"] = latest[i].unread;
+            item["TSMSCount"]   = latest[i].count;
+            list.push_back(std::move(item));
+        }
+        return {{"SMSContactList", std::move(list)},
+                {"Page", page},
+                {"TotalPageCount", pages(latest.size())}};
+    }
+
+    // reading the contents of a contact marks them read
+    json content_list(const json& params) {
+        const auto id = params.value("ContactId", -1);
+        const auto it = _contacts.find(id);
+        if (it == _contacts.end())
+            throw RpcError{INVALID_PARAMS, "unknown contact"};
+
+        vector<Sms*> contents{};
+        for (auto& s : _smses)
+            if (s.contact_id == id) contents.push_back(&s);
+
+        const auto page = params.value("Page", size_t{});
+        auto       list = json::array();
+        for (size_t i = page * _config.page_size;
+             i < std::min(contents.size(), (page + 1) * _config.page_size);
+             ++i) {
+            list.push_back(sms_json(*contents[i]));
+            if (contents[i]->type == UNREAD) contents[i]->type = READ;
+        }
+        return {{"SMSContentList", std::move(list)},
+                {"Page", page},
+                {"TotalPageCount", pages(contents.size())},
+                {"ContactId", id},
+                {"PhoneNumber", it->second.numbers}};
+    }
+
+    // one SMS is sent at a time, as on the dongle
+    json send(const json& params) {
+        const auto now = steady_clock::now();
+        if (_send_status == SENDING && now < _send_done)
+            throw RpcError{BUSY, "an SMS is being sent"};
+
+        vector<string> numbers{};
+        string         content{};
+        try {
+            params.at("PhoneNumber").get_to(numbers);
+            params.at("SMSContent").get_to(content);
+        } catch (const json::exception& e) {
+            throw RpcError{INVALID_PARAMS, e.what()};
+        }
+        if (full()) {
+            _send_status = FULL;
+            return json::object();
+        }
+        _send_outcome = chance(_config.fail_send) ? SEND_FAILED : SUCCESS;
+        _send_status  = SENDING;
+        _send_done    = now + _config.sending;
+        if (_config.keep_sent)
+            store(contact(numbers), _send_outcome == SUCCESS ? SENT : FAILED,
+                  std::move(content));
+        return json::object();
+    }
+
+    json send_result() {
+        if (_send_status == SENDING && steady_clock::now() >= _send_done)
+            _send_status = _send_outcome;
+        return {{"SendStatus", _send_status}};
+    }
+
+    json remove(const json& params) {
+        const auto flag = params.value("DelFlag", -1);
+        const auto id   = params.value("ContactId", -1);
+        const auto sms  = params.value("SMSId", -1);
+        switch (flag) {
+            case ALL:
+                _smses.clear();
+                _contacts.clear();
+                break;
+            case CONTACT:
+                std::erase_if(_smses, [id](const Sms& s) {
+                    return s.contact_id == id;
+                });
+                _contacts.erase(id);
+                break;
+            case CONTENT:
+                std::erase_if(_smses, [id, sms](const Sms& s) {
+                    return s.contact_id == id && s.id == sms;
+                });
+                break;
+            default:
+                throw RpcError{INVALID_PARAMS, "unknown DelFlag"};
+        }
+        return json::object();
+    }
+
+    size_t pages(size_t items) const {
+        return (items + _config.page_size - 1) / _config.page_size;
+    }
+
+    json call(const string& method, const json& params) {
+        ++_counts[method];
+        if (method == "HeartBeat") return json::object();
+        if (method == "GetSystemInfo") return system_info();
+        if (method == "GetSystemStatus") return system_status();
+        if (method == "GetConnectionState") return connection_state();
+        if (method == "GetSMSStorageState") return storage_state();
+        if (method == "GetSMSContactList") return contact_list(params);
+        if (method == "GetSMSContentList") return content_list(params);
+        if (method == "SendSMS") return send(params);
+        if (method == "GetSendSMSResult") return send_result();
+        if (method == "DeleteSMS") return remove(params);
+        throw RpcError{METHOD_NOT_FOUND, fmt::format("no method {}", method)};
+    }
+
+    json answer(const json& req) {
+        const auto id = req.contains("id") ? req["id"] : json{};
+        try {
+            if (!req.is_object() || !req.contains("method"))
+                throw RpcError{INVALID_PARAMS, "not a request"};
+            const auto params = req.value("params", json::object());
+            return {{"jsonrpc", "2.0"},
+                    {"result", call(req["method"].get<string>(), params)},
+                    {"id", id}};
+        } catch (const RpcError& e) {
+            return {{"jsonrpc", "2.0"},
+                    {"error", {{"code", e.code}, {"message", e.message}}},
+                    {"id", id}};
+        }
+    }
+};
+
+Device::Device(Config config) : _impl(std::make_unique<_Impl>(config)) {}
+
+Device::Device(Device&&) noexcept = default;
+
+Device::~Device() = default;
+
+Device::Reply Device::handle(string_view body) {
+    milliseconds wait{};
+    bool         failed{};
+    {
+        std::lock_guard<std::mutex> lock(_impl->_mutex);
+        wait   = _impl->delay();
+        failed = _impl->chance(_impl->_config.fail_rpc);
+    }
+    // the latency is waited outside the lock, as concurrent requests
+    // would be on a real link
+    if (wait.count() > 0) std::this_thread::sleep_for(wait);
+    if (failed) return {503, {}};
+
+    json req{};
+    try {
+        req = json::parse(body);
+    } catch (const json::parse_error& e) {
+        return {200, json{{"jsonrpc", "2.0"},
+                          {"error", {{"code", PARSE_ERROR},
+                                     {"message", e.what()}}},
+                          {"id", nullptr}}
+                         .dump()};
+    }
+
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    if (!req.is_array()) return {200, _impl->answer(req).dump()};
+
+    auto res = json::array();
+    for (const auto& r : req) res.push_back(_impl->answer(r));
+    return {200, res.dump()};
+}
+
+void Device::receive(const string& phone_number, string content) {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    if (_impl->full()) return;
+    _impl->store(_impl->contact({phone_number}), UNREAD, std::move(content));
+}
+
+vector<Device::Count> Device::counts() {
+    std::lock_guard<std::mutex> lock(_impl->_mutex);
+    vector<Count> res{};
+    for (const auto& [method, n] : _impl->_counts) res.push_back({method, n});
+    return res;
+}
+}  // namespace mock
@@ -0,0 +1,69 @@
+#ifndef MOCK_DEVICE_HPP
+#define MOCK_DEVICE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mock {
+using std::size_t;
+using std::string;
+using std::string_view;
+using std::vector;
+using std::chrono::milliseconds;
+
+/// behaviour of the mock dongle, the defaults answer at once and never fail
+struct Config {
+    milliseconds  latency;    // added to every http request
+    milliseconds  jitter;     // uniform random extra on top of the latency
+    milliseconds  sending;    // a sent SMS stays SENDING this long
+    double        fail_send;  // share of the SMSes ending FAILED
+    double        fail_rpc;   // share of the requests answered with http 503
+    size_t        storage;    // SMSes kept, sending into a full one is FULL
+    bool          keep_sent;  // sent SMSes are stored and count as used
+    size_t        page_size;  // contacts or contents on one list page
+    size_t        inbox;      // received SMSes seeded into the storage
+    std::uint32_t seed;       // of the random failures and the jitter
+};
+
+/// in memory model of an Alcatel IK41 answering the /jrd/webapi JSON-RPC
+/// methods the daemon uses; thread safe, every request is served by
+/// handle() on the http thread which took it
+class Device {
+    struct _Impl;
+    std::unique_ptr<_Impl> _impl;
+
+   public:
+    /// answer of one http request
+    struct Reply {
+        int    status;  // http status, 200 or 503 of an injected failure
+        string body;
+    };
+
+    /// per method request counters
+    struct Count {
+        string method;
+        size_t requests;
+    };
+
+    explicit Device(Config config);
+
+    Device(Device&&) noexcept;
+
+    virtual ~Device();
+
+    /// serves one request or a batch of them, waits the configured latency
+    Reply handle(string_view body);
+
+    /// stores a received SMS from the phone number
+    void receive(const string& phone_number, string content);
+
+    vector<Count> counts();
+};
+}  // namespace mock
+
+#endif  // MOCK_DEVICE_HPP
@@ -0,0 +1,140 @@
+// mock Alcatel dongle: serves the /jrd/webapi JSON-RPC methods the daemon
+// uses from an in memory SMS storage, for testing and benchmarking without
+// a modem
+//
+// usage: asmsd-mockdev [--port 8080] [--latency ms] [--sending ms] ...
+
+#include "mock_device.hpp"
+
+#include <signal.h>
+#include <sysexits.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "cxxopts.hpp"
+#include "fmt/core.h"
+#include "httplib.h"
+#include "lambda_signal.hpp"
+
+namespace {
+using std::string;
+using std::chrono::milliseconds;
+using std::chrono::minutes;
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    using cxxopts::value;
+
+    cxxopts::Options opts("asmsd-mockdev", "mock Alcatel dongle for asmsd");
+
+    string host{}, base_path{};
+    int    port{};
+    long   latency{}, jitter{}, sending{};
+    size_t incoming{};
+
+    mock::Config config{};
+
+    opts.set_width(90).add_options()  //
+        ("h,host", "address to listen on",
+         value(host)->default_value("127.0.0.1"))(
+            "p,port", "port to listen on", value(port)->default_value("8080"))(
+            "b,base-path", "path of the json rpc endpoint",
+            value(base_path)->default_value("/jrd/webapi"))(
+            "latency", "milliseconds added to every request",
+            value(latency)->default_value("0"))(
+            "jitter", "random milliseconds on top of the latency",
+            value(jitter)->default_value("0"))(
+            "sending", "milliseconds an SMS stays SENDING",
+            value(sending)->default_value("1000"))(
+            "fail-send", "share of the SMSes ending FAILED, 0 to 1",
+            value(config.fail_send)->default_value("0"))(
+            "fail-rpc", "share of the requests answered with http 503",
+            value(config.fail_rpc)->default_value("0"))(
+            "storage", "SMSes the storage takes, sending into a full one fails",
+            value(config.storage)->default_value("100"))(
+            "keep-sent", "store the sent SMSes, they fill the storage",
+            value(config.keep_sent)->default_value("false"))(
+            "page-size", "contacts or contents on one list page",
+            value(config.page_size)->default_value("10"))(
+            "inbox", "received SMSes in the storage on start",
+            value(config.inbox)->default_value("0"))(
+            "incoming", "SMSes received per minute while running",
+            value(incoming)->default_value("0"))(
+            "seed", "seed of the random failures and the jitter",
+            value(config.seed)->default_value("1"))("help", "print usage");
+
+    try {
+        const auto result = opts.parse(argc, argv);
+        if (result.count("help")) {
+            fmt::print("{}", opts.help());
+            return EXIT_SUCCESS;
+        }
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "{}, see usage: asmsd-mockdev --help\n", e.what());
+        return EX_USAGE;
+    }
+    if (config.page_size == 0 || config.fail_send < 0 ||
+        config.fail_send > 1 || config.fail_rpc < 0 || config.fail_rpc > 1) {
+        fmt::print(stderr, "see usage: asmsd-mockdev --help\n");
+        return EX_USAGE;
+    }
+    config.latency = milliseconds{latency};
+    config.jitter  = milliseconds{jitter};
+    config.sending = milliseconds{sending};
+
+    mock::Device    device{config};
+    httplib::Server server{};
+    server.Post(base_path,
+                [&device](const httplib::Request& req, httplib::Response& res) {
+                    auto reply = device.handle(req.body);
+                    res.status = reply.status;
+                    if (!reply.body.empty())
+                        res.set_content(std::move(reply.body),
+                                        "application/json");
+                });
+
+    // incoming SMSes are spread over a few senders
+    std::mutex              mutex;
+    std::condition_variable stop_cv;
+    bool                    stopping{};
+    std::thread             receiver{};
+    if (incoming > 0)
+        receiver = std::thread([&]() {
+            const auto period = std::chrono::duration_cast<milliseconds>(
+                minutes{1}) / incoming;
+            std::unique_lock<std::mutex> lock(mutex);
+            for (size_t i{}; !stop_cv.wait_for(lock, period,
+                                               [&] { return stopping; });
+                 ++i)
+                device.receive(fmt::format("+3671{:07}", i % 5),
+                               fmt::format("received message #{}", i + 1));
+        });
+
+    SignalScope<SIGINT> sigint([&server](int) { server.stop(); });
+    SignalScope<SIGTERM> sigterm([&server](int) { server.stop(); });
+
+    fmt::print(stderr, "mock dongle on http://{}:{}{}\n", host, port,
+               base_path);
+    if (!server.listen(host.c_str(), port)) {
+        fmt::print(stderr, "unable to listen on {}:{}\n", host, port);
+        return EX_UNAVAILABLE;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    stop_cv.notify_all();
+    if (receiver.joinable()) receiver.join();
+
+    for (const auto& count : device.counts())
+        fmt::print(stderr, "{}: {} requests\n", count.method, count.requests);
+    return EXIT_SUCCESS;
+}